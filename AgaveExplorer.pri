@@ -12,18 +12,60 @@ INCLUDEPATH += "$$PWD/"
 
 SOURCES += \
     $$PWD/utilFuncs/agavesetupdriver.cpp \
+    $$PWD/utilFuncs/agavesession.cpp \
     $$PWD/utilFuncs/authform.cpp \
+    $$PWD/utilFuncs/batchengine.cpp \
+    $$PWD/utilFuncs/bulkfileoperation.cpp \
+    $$PWD/utilFuncs/coalescedrequest.cpp \
     $$PWD/utilFuncs/copyrightdialog.cpp \
+    $$PWD/utilFuncs/diskwriterpool.cpp \
+    $$PWD/utilFuncs/filebuffercache.cpp \
+    $$PWD/utilFuncs/folderprefetcher.cpp \
+    $$PWD/utilFuncs/httpresponsecache.cpp \
+    $$PWD/utilFuncs/jobnotificationlistener.cpp \
+    $$PWD/utilFuncs/joblistmodel.cpp \
+    $$PWD/utilFuncs/joboutputharvester.cpp \
+    $$PWD/utilFuncs/jobtaildialog.cpp \
+    $$PWD/utilFuncs/listingstreamparser.cpp \
+    $$PWD/utilFuncs/localtreescanner.cpp \
+    $$PWD/utilFuncs/multipartuploader.cpp \
+    $$PWD/utilFuncs/remotepath.cpp \
+    $$PWD/utilFuncs/servicerequest.cpp \
     $$PWD/utilFuncs/singlelinedialog.cpp \
+    $$PWD/utilFuncs/stallwatchdog.cpp \
+    $$PWD/utilFuncs/streamchecksum.cpp \
+    $$PWD/utilFuncs/trafficnetmanager.cpp \
+    $$PWD/utilFuncs/transferjournal.cpp \
     $$PWD/ae_globals.cpp \   
     $$PWD/commonUI/FooterWidget.cpp \
     $$PWD/commonUI/HeaderWidget.cpp
 
 HEADERS += \
     $$PWD/utilFuncs/agavesetupdriver.h \
+    $$PWD/utilFuncs/agavesession.h \
     $$PWD/utilFuncs/authform.h \
+    $$PWD/utilFuncs/batchengine.h \
+    $$PWD/utilFuncs/bulkfileoperation.h \
+    $$PWD/utilFuncs/coalescedrequest.h \
     $$PWD/utilFuncs/copyrightdialog.h \
+    $$PWD/utilFuncs/diskwriterpool.h \
+    $$PWD/utilFuncs/filebuffercache.h \
+    $$PWD/utilFuncs/folderprefetcher.h \
+    $$PWD/utilFuncs/httpresponsecache.h \
+    $$PWD/utilFuncs/jobnotificationlistener.h \
+    $$PWD/utilFuncs/joblistmodel.h \
+    $$PWD/utilFuncs/joboutputharvester.h \
+    $$PWD/utilFuncs/jobtaildialog.h \
+    $$PWD/utilFuncs/listingstreamparser.h \
+    $$PWD/utilFuncs/localtreescanner.h \
+    $$PWD/utilFuncs/multipartuploader.h \
+    $$PWD/utilFuncs/remotepath.h \
+    $$PWD/utilFuncs/servicerequest.h \
     $$PWD/utilFuncs/singlelinedialog.h \
+    $$PWD/utilFuncs/stallwatchdog.h \
+    $$PWD/utilFuncs/streamchecksum.h \
+    $$PWD/utilFuncs/trafficnetmanager.h \
+    $$PWD/utilFuncs/transferjournal.h \
     $$PWD/ae_globals.h \
     $$PWD/commonUI/FooterWidget.h \
     $$PWD/commonUI/HeaderWidget.h
@@ -46,7 +46,8 @@ TEMPLATE = app
 SOURCES += \
     main.cpp \
     instances/explorerdriver.cpp \
-    instances/explorerwindow.cpp
+    instances/explorerwindow.cpp \
+    instances/headlessrunner.cpp
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked deprecated (the exact warnings
@@ -62,6 +63,7 @@ DEFINES += QT_DEPRECATED_WARNINGS
 HEADERS += \
     instances/explorerdriver.h \
     instances/explorerwindow.h \
+    instances/headlessrunner.h \
 
 FORMS += \
     instances/explorerwindow.ui \
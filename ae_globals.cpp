@@ -35,6 +35,9 @@
 
 #include "ae_globals.h"
 
+#include <QFileInfo>
+#include <QJsonObject>
+
 #include "utilFuncs/agavesetupdriver.h"
 
 AgaveSetupDriver * ae_globals::theDriver = nullptr;
@@ -69,17 +72,31 @@ bool ae_globals::isValidFolderName(QString folderName)
     {
         return false;
     }
+    return namePassesTable(folderName, folderNameTable());
+}
 
-    for (QChar aLetter : folderName)
+bool ae_globals::isUploadableName(QString entryName)
+{
+    if (entryName.isEmpty() || (entryName == ".") || (entryName == ".."))
     {
-        if (aLetter.isDigit()) continue;
-        if (aLetter.isSpace()) continue;
-        if (aLetter.isLetter()) continue;
-        if (aLetter == '_') continue;
         return false;
     }
 
-    //TODO: PRS
+    //Only names the remote file service cannot store are refused:
+    //path separators, control characters and unpaired surrogates, which have no UTF-8 form
+    const ushort * nameData = entryName.utf16();
+    int nameLength = entryName.size();
+    for (int i = 0; i < nameLength; i++)
+    {
+        ushort aCode = nameData[i];
+        if ((aCode < 0x20) || (aCode == 0x7F) || (aCode == '/')) return false;
+        if (QChar::isLowSurrogate(aCode)) return false;
+        if (QChar::isHighSurrogate(aCode))
+        {
+            if ((i + 1 >= nameLength) || !QChar::isLowSurrogate(nameData[i + 1])) return false;
+            i++;
+        }
+    }
     return true;
 }
 
@@ -89,30 +106,80 @@ bool ae_globals::isValidLocalFolder(QString folderName)
     {
         return false;
     }
-    //TODO: PRS
-    return true;
+
+    QFileInfo folderInfo(folderName);
+    return folderInfo.exists() && folderInfo.isDir() && folderInfo.isReadable();
 }
 
-bool ae_globals::folderNamesMatch(QString folder1, QString folder2)
+const ae_globals::NameTable &ae_globals::folderNameTable()
 {
-    QStringList folderParts1 = folder1.split('\\');
-    QStringList folderParts2 = folder2.split('\\');
+    static const NameTable theTable = buildNameTable();
+    return theTable;
+}
 
-    if (folderParts1.size() != folderParts2.size())
+ae_globals::NameTable ae_globals::buildNameTable()
+{
+    NameTable newTable;
+    for (int i = 0; i < 256; i++)
     {
-        return false;
+        QChar aLetter(i);
+        newTable.allowed[i] = aLetter.isDigit() || aLetter.isSpace() || aLetter.isLetter() || (aLetter == '_');
     }
+    return newTable;
+}
 
-    for (int i = 0; i < folderParts1.size(); i++)
+bool ae_globals::namePassesTable(const QString &aName, const NameTable &theTable)
+{
+    //Latin-1 characters are checked by table, others fall back on QChar's classification
+    const ushort * nameData = aName.utf16();
+    int nameLength = aName.size();
+    for (int i = 0; i < nameLength; i++)
     {
-        if (folderParts1.at(i) != folderParts2.at(i))
+        ushort aCode = nameData[i];
+        if (aCode < 256)
         {
-            return false;
+            if (!theTable.allowed[aCode]) return false;
+            continue;
         }
+
+        uint aPoint = aCode;
+        if (QChar::isHighSurrogate(aCode) && (i + 1 < nameLength) && QChar::isLowSurrogate(nameData[i + 1]))
+        {
+            aPoint = QChar::surrogateToUcs4(aCode, nameData[i + 1]);
+            i++;
+        }
+
+        if (QChar::isDigit(aPoint)) continue;
+        if (QChar::isSpace(aPoint)) continue;
+        if (QChar::isLetter(aPoint)) continue;
+        return false;
     }
     return true;
 }
 
+bool ae_globals::folderNamesMatch(QString folder1, QString folder2)
+{
+    //Comparing every part after splitting on the separator is the same as comparing the whole strings
+    return (folder1 == folder2);
+}
+
+QStringList ae_globals::parseAppNames(const QVariantList &appList)
+{
+    QStringList appNames;
+    appNames.reserve(appList.size());
+
+    for (auto itr = appList.constBegin(); itr != appList.constEnd(); itr++)
+    {
+        QString appName = (*itr).toJsonObject().value("name").toString();
+
+        if (!appName.isEmpty())
+        {
+            appNames.append(appName);
+        }
+    }
+    return appNames;
+}
+
 AgaveSetupDriver * ae_globals::get_Driver()
 {
     return theDriver;
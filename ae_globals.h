@@ -38,6 +38,8 @@
 
 #include <QMessageBox>
 #include <QLoggingCategory>
+#include <QStringList>
+#include <QVariant>
 
 Q_DECLARE_LOGGING_CATEGORY(agaveAppLayer)
 
@@ -70,9 +72,14 @@ public:
     static void displayPopup(QString message, QString header = "Error");
 
     static bool isValidFolderName(QString folderName);
+    static bool isUploadableName(QString entryName);
     static bool isValidLocalFolder(QString folderName);
     static bool folderNamesMatch(QString folder1, QString folder2);
 
+    /*! \brief Returns the names of the apps in an Agave app list reply, skipping entries without a name.
+     */
+    static QStringList parseAppNames(const QVariantList &appList);
+
     static AgaveSetupDriver * get_Driver();
     static void set_Driver(AgaveSetupDriver * newDriver);
 
@@ -81,6 +88,15 @@ public:
     static FileOperator * get_file_handle();
 
 private:    
+    struct NameTable
+    {
+        bool allowed[256];
+    };
+
+    static const NameTable &folderNameTable();
+    static NameTable buildNameTable();
+    static bool namePassesTable(const QString &aName, const NameTable &theTable);
+
     static AgaveSetupDriver * theDriver;
 };
 
@@ -0,0 +1,566 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+/* Microbenchmarks for the client-side CPU paths of AgaveExplorer.
+ *
+ * Arguments, all optional:
+ * baseline <file>       Compare the results with a stored baseline, and exit with 1 if any case is slower by more than the tolerance
+ * writeBaseline <file>  Store the results as a new baseline
+ * tolerance <fraction>  Allowed slowdown against the baseline, default 0.2
+ * maxSize <n>           Largest input size to run, default 1000000
+ * filter <text>         Only run cases whose name contains the text
+ *
+ * The results are printed to stdout as JSON, one entry per case and input size, giving the time per input item in nanoseconds.
+ * Human-readable progress and the baseline comparison go to stderr.
+ * Cases check their own results, and XXH64 is checked against known answers. Any wrong result makes the program exit with 1.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QVariant>
+#include <QSet>
+
+#include <functional>
+
+#include "agaveInterfaces/agavetaskreply.h"
+#include "filemetadata.h"
+
+#include "utilFuncs/listingstreamparser.h"
+#include "utilFuncs/remotepath.h"
+#include "utilFuncs/streamchecksum.h"
+#include "ae_globals.h"
+
+static const qint64 MIN_CASE_TIME = 300;
+
+//The synthetic listing is about 430 bytes per entry, and Qt 5's QJsonDocument refuses documents
+//past its internal size limit (about 128 MB), so the DOM case stops well below that
+static const int MAX_DOM_LISTING_SIZE = 100000;
+static const int MIN_CASE_RUNS = 3;
+static const int MAX_CASE_RUNS = 1000;
+
+//Roughly what one network read delivers
+static const int STREAM_CHUNK_SIZE = 16384;
+
+//Results are summed here so that the timed work cannot be optimized away
+static volatile qint64 benchSink = 0;
+
+struct BenchResult
+{
+    QString name;
+    qint64 size;
+    int runs;
+    double nsPerItem;
+};
+
+class BenchRunner
+{
+public:
+    BenchRunner(qint64 maxSize, QString filter)
+    {
+        myMaxSize = maxSize;
+        myFilter = filter;
+    }
+
+    bool wanted(QString name, qint64 size)
+    {
+        if (size > myMaxSize) return false;
+        return myFilter.isEmpty() || name.contains(myFilter);
+    }
+
+    void timeCase(QString name, qint64 size, std::function<void()> body)
+    {
+        if (!wanted(name, size)) return;
+
+        //One untimed run, to warm caches and allocators
+        body();
+
+        QElapsedTimer totalTimer;
+        totalTimer.start();
+        qint64 bestTime = -1;
+        int runs = 0;
+        while ((runs < MIN_CASE_RUNS) || ((totalTimer.elapsed() < MIN_CASE_TIME) && (runs < MAX_CASE_RUNS)))
+        {
+            QElapsedTimer runTimer;
+            runTimer.start();
+            body();
+            qint64 runTime = runTimer.nsecsElapsed();
+            if ((bestTime < 0) || (runTime < bestTime)) bestTime = runTime;
+            runs++;
+        }
+
+        BenchResult newResult;
+        newResult.name = name;
+        newResult.size = size;
+        newResult.runs = runs;
+        newResult.nsPerItem = (double) bestTime / qMax((qint64) 1, size);
+        resultList.append(newResult);
+
+        QTextStream(stderr) << QString("%1 [%2]: %3 ns/item (%4 runs)").arg(name).arg(size).arg(newResult.nsPerItem, 0, 'f', 2).arg(runs) << endl;
+    }
+
+    /*! \brief Records that a case produced a wrong result, so its timing cannot be trusted.
+     *
+     *  Each case is only reported once, however often it fails.
+     */
+    void failCase(QString name, qint64 size, QString reason)
+    {
+        QString aKey = caseKey(name, size);
+        if (failedCases.contains(aKey)) return;
+        failedCases.insert(aKey);
+        QTextStream(stderr) << aKey << ": FAILED: " << reason << endl;
+    }
+
+    int getFailureCount()
+    {
+        return failedCases.size();
+    }
+
+    QJsonDocument getResults()
+    {
+        QJsonArray resultArray;
+        for (const BenchResult &aResult : resultList)
+        {
+            QJsonObject resultObject;
+            resultObject.insert("name", aResult.name);
+            resultObject.insert("size", aResult.size);
+            resultObject.insert("runs", aResult.runs);
+            resultObject.insert("nsPerItem", aResult.nsPerItem);
+            resultArray.append(resultObject);
+        }
+
+        QJsonObject rootObject;
+        rootObject.insert("benchmarks", resultArray);
+        return QJsonDocument(rootObject);
+    }
+
+    int compareWithBaseline(QString baselineFile, double tolerance)
+    {
+        QFile baselineData(baselineFile);
+        if (!baselineData.open(QIODevice::ReadOnly))
+        {
+            QTextStream(stderr) << "Unable to open baseline file: " << baselineFile << endl;
+            return 1;
+        }
+
+        QMap<QString, double> baselineTimes;
+        for (QJsonValue anEntry : QJsonDocument::fromJson(baselineData.readAll()).object().value("benchmarks").toArray())
+        {
+            QJsonObject entryObject = anEntry.toObject();
+            baselineTimes.insert(caseKey(entryObject.value("name").toString(), (qint64) entryObject.value("size").toDouble()),
+                                 entryObject.value("nsPerItem").toDouble());
+        }
+
+        int regressionCount = 0;
+        QTextStream reportStream(stderr);
+        for (const BenchResult &aResult : resultList)
+        {
+            QString aKey = caseKey(aResult.name, aResult.size);
+            if (!baselineTimes.contains(aKey))
+            {
+                reportStream << aKey << ": not in baseline" << endl;
+                continue;
+            }
+
+            double baseTime = baselineTimes.value(aKey);
+            double changeRatio = (baseTime > 0) ? (aResult.nsPerItem / baseTime) : 1.0;
+            bool regressed = (changeRatio > 1.0 + tolerance);
+            if (regressed) regressionCount++;
+
+            reportStream << QString("%1: %2 vs %3 ns/item (%4%)%5")
+                            .arg(aKey).arg(aResult.nsPerItem, 0, 'f', 2).arg(baseTime, 0, 'f', 2)
+                            .arg((changeRatio - 1.0) * 100.0, 0, 'f', 1).arg(regressed ? " REGRESSION" : "") << endl;
+        }
+
+        reportStream << regressionCount << " regressions against " << baselineFile << endl;
+        return (regressionCount == 0) ? 0 : 1;
+    }
+
+private:
+    static QString caseKey(QString name, qint64 size)
+    {
+        return QString("%1/%2").arg(name).arg(size);
+    }
+
+    qint64 myMaxSize;
+    QString myFilter;
+    QList<BenchResult> resultList;
+    QSet<QString> failedCases;
+};
+
+static QStringList makeFolderNames(int count)
+{
+    static const QString nameLetters("abcdefghijklmnopqrstuvwxyz_ 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+
+    QStringList nameList;
+    for (int i = 0; i < count; i++)
+    {
+        QString newName;
+        for (int j = 0; j < 8 + (i % 24); j++)
+        {
+            newName.append(nameLetters.at((i * 7 + j * 13) % nameLetters.size()));
+        }
+        //Every fifth name has a character which is not allowed
+        if ((i % 5) == 0) newName.append('/');
+        nameList.append(newName);
+    }
+    return nameList;
+}
+
+static QStringList makeFolderPaths(int count)
+{
+    QStringList pathList;
+    for (int i = 0; i < count; i++)
+    {
+        pathList.append(QString("user\\projects\\case%1\\stage%2\\constant\\polyMesh").arg(i % 100).arg(i % 7));
+    }
+    return pathList;
+}
+
+static QVariantList makeAppList(int count)
+{
+    QVariantList appList;
+    appList.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        QJsonObject appObject;
+        appObject.insert("id", QString("app-%1-0.1u1").arg(i));
+        appObject.insert("name", QString("app-%1").arg(i));
+        appObject.insert("version", "0.1");
+        appObject.insert("revision", 1);
+        appObject.insert("executionSystem", "designsafe.community.exec.stampede2");
+        appObject.insert("shortDescription", "Synthetic app entry for benchmarking");
+        appObject.insert("isPublic", true);
+        appObject.insert("label", QString("Synthetic App %1").arg(i));
+        appList.append(QVariant(appObject));
+    }
+    return appList;
+}
+
+static QByteArray makeListingJson(int count)
+{
+    QByteArray listingData;
+    listingData.reserve(count * 400);
+    listingData.append("{\"status\":\"success\",\"message\":null,\"version\":\"2.2.14\",\"result\":[");
+
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0) listingData.append(',');
+        bool isFolder = ((i % 10) == 0);
+        QString entryName = isFolder ? QString("folder%1").arg(i) : QString("result_%1.csv").arg(i);
+
+        listingData.append(QString("{\"name\":\"%1\",\"path\":\"/benchuser/listing/%1\",\"lastModified\":\"2017-11-02T10:20:30.000-05:00\","
+                                   "\"length\":%2,\"permissions\":\"ALL\",\"format\":\"%3\",\"system\":\"designsafe.storage.default\","
+                                   "\"mimeType\":\"%4\",\"type\":\"%5\",\"_links\":{\"self\":{\"href\":\"https://agave.designsafe-ci.org/files/v2/media/system/designsafe.storage.default//benchuser/listing/%1\"}}}")
+                           .arg(entryName).arg(isFolder ? 4096 : (i * 37) % 100000)
+                           .arg(isFolder ? "folder" : "raw").arg(isFolder ? "text/directory" : "text/csv")
+                           .arg(isFolder ? "dir" : "file").toUtf8());
+    }
+    listingData.append("]}");
+    return listingData;
+}
+
+static void runFolderNameCases(BenchRunner &theRunner)
+{
+    const int nameCount = 100000;
+    QStringList folderNames = makeFolderNames(nameCount);
+    theRunner.timeCase("isValidFolderName", nameCount, [&folderNames]() {
+        qint64 validCount = 0;
+        for (const QString &aName : folderNames)
+        {
+            if (ae_globals::isValidFolderName(aName)) validCount++;
+        }
+        benchSink += validCount;
+    });
+
+    QStringList folderPaths = makeFolderPaths(nameCount);
+    theRunner.timeCase("folderNamesMatch", nameCount, [&folderPaths]() {
+        qint64 matchCount = 0;
+        for (int i = 0; i < folderPaths.size(); i++)
+        {
+            if (ae_globals::folderNamesMatch(folderPaths.at(i), folderPaths.at((i * 31) % folderPaths.size()))) matchCount++;
+        }
+        benchSink += matchCount;
+    });
+
+    QStringList remotePaths;
+    for (int i = 0; i < nameCount; i++)
+    {
+        remotePaths.append(QString("/benchuser/projects/case%1/stage%2/constant/file%3").arg(i % 100).arg(i % 7).arg(i));
+    }
+    theRunner.timeCase("remotePathIntern", nameCount, [&remotePaths]() {
+        qint64 depthSum = 0;
+        for (const QString &aPath : remotePaths)
+        {
+            depthSum += RemotePath(aPath).getDepth();
+        }
+        benchSink += depthSum;
+    });
+
+    QList<RemotePath> internedPaths;
+    for (const QString &aPath : remotePaths)
+    {
+        internedPaths.append(RemotePath(aPath));
+    }
+    theRunner.timeCase("remotePathParentMatch", nameCount, [&internedPaths]() {
+        qint64 matchCount = 0;
+        for (int i = 0; i < internedPaths.size(); i++)
+        {
+            if (internedPaths.at(i).getParent() == internedPaths.at((i * 31) % internedPaths.size()).getParent()) matchCount++;
+        }
+        benchSink += matchCount;
+    });
+}
+
+static void runAppListCases(BenchRunner &theRunner)
+{
+    for (int listSize = 1000; listSize <= 1000000; listSize *= 10)
+    {
+        if (!theRunner.wanted("parseAppNames", listSize)) continue;
+
+        QVariantList appList = makeAppList(listSize);
+        theRunner.timeCase("parseAppNames", listSize, [&appList]() {
+            benchSink += ae_globals::parseAppNames(appList).size();
+        });
+    }
+}
+
+static void runListingCases(BenchRunner &theRunner)
+{
+    for (int listSize = 1000; listSize <= 1000000; listSize *= 10)
+    {
+        if (!theRunner.wanted("listingDomParse", listSize) && !theRunner.wanted("listingStreamParse", listSize)) continue;
+
+        QByteArray listingData = makeListingJson(listSize);
+        if (listSize <= MAX_DOM_LISTING_SIZE)
+        {
+            theRunner.timeCase("listingDomParse", listSize, [&theRunner, &listingData, listSize]() {
+                QJsonParseError parseError;
+                QJsonDocument listingDoc = QJsonDocument::fromJson(listingData, &parseError);
+                if (parseError.error != QJsonParseError::NoError)
+                {
+                    theRunner.failCase("listingDomParse", listSize, parseError.errorString());
+                    return;
+                }
+                QJsonArray fileArray = listingDoc.object().value("result").toArray();
+
+                QList<FileMetaData> fileList;
+                fileList.reserve(fileArray.size());
+                for (QJsonValue anEntry : fileArray)
+                {
+                    fileList.append(AgaveTaskReply::parseJSONfileMetaData(anEntry.toObject()));
+                }
+                if (fileList.size() != listSize)
+                {
+                    theRunner.failCase("listingDomParse", listSize, QString("parsed %1 entries").arg(fileList.size()));
+                }
+                benchSink += fileList.size();
+            });
+        }
+
+        theRunner.timeCase("listingStreamParse", listSize, [&theRunner, &listingData, listSize]() {
+            ListingStreamParser theParser;
+            QList<FileMetaData> fileList;
+            qint64 peakBuffer = 0;
+
+            for (int chunkStart = 0; chunkStart < listingData.size(); chunkStart += STREAM_CHUNK_SIZE)
+            {
+                theParser.addData(QByteArray::fromRawData(listingData.constData() + chunkStart, qMin(STREAM_CHUNK_SIZE, listingData.size() - chunkStart)));
+                peakBuffer = qMax(peakBuffer, theParser.getBufferedBytes());
+
+                while (theParser.hasEntry())
+                {
+                    fileList.append(AgaveTaskReply::parseJSONfileMetaData(theParser.takeEntry()));
+                }
+            }
+            if (theParser.hasError() || !theParser.resultComplete())
+            {
+                theRunner.failCase("listingStreamParse", listSize, "listing not parsed to the end");
+            }
+            else if (fileList.size() != listSize)
+            {
+                theRunner.failCase("listingStreamParse", listSize, QString("parsed %1 entries").arg(fileList.size()));
+            }
+            benchSink += fileList.size() + peakBuffer;
+        });
+    }
+}
+
+struct ChecksumVector
+{
+    QByteArray input;
+    QList<int> splitPoints;
+    QString expected;
+};
+
+static QByteArray makeVectorPattern(int count)
+{
+    QByteArray patternData(count, Qt::Uninitialized);
+    for (int i = 0; i < count; i++)
+    {
+        patternData[i] = (char) ((i * 7 + 3) & 0xff);
+    }
+    return patternData;
+}
+
+static void checkChecksumVectors(BenchRunner &theRunner)
+{
+    //Known answers of the reference XXH64, with seed 0. Longer inputs are fed across odd boundaries, so buffered and direct lanes are both used.
+    const QList<ChecksumVector> vectorList = {
+        {QByteArray(), {}, "xxh64:ef46db3751d8e999"},
+        {QByteArray("a"), {}, "xxh64:d24ec4f1a98c6e5b"},
+        {QByteArray("abc"), {1}, "xxh64:44bc2cf5ad770999"},
+        {QByteArray("Nobody inspects the spammish repetition"), {5, 34}, "xxh64:fbcea83c8a378bf1"},
+        {makeVectorPattern(100), {1, 8, 31, 33, 70}, "xxh64:a61f8d4c170fe531"},
+    };
+
+    for (int i = 0; i < vectorList.size(); i++)
+    {
+        const ChecksumVector &aVector = vectorList.at(i);
+        StreamChecksum theChecksum(ChecksumType::XXH64);
+        int pieceStart = 0;
+        for (int splitPoint : aVector.splitPoints + QList<int>({aVector.input.size()}))
+        {
+            theChecksum.addData(aVector.input.constData() + pieceStart, splitPoint - pieceStart);
+            pieceStart = splitPoint;
+        }
+
+        QString checksumResult = theChecksum.getResult();
+        if ((checksumResult != aVector.expected) || (theChecksum.getLength() != aVector.input.size()))
+        {
+            theRunner.failCase("checksumXXH64Vector", i, QString("got %1, expected %2").arg(checksumResult, aVector.expected));
+        }
+    }
+}
+
+static void runChecksumCases(BenchRunner &theRunner)
+{
+    checkChecksumVectors(theRunner);
+
+    const int dataSize = 1000000;
+    QByteArray transferData(dataSize, Qt::Uninitialized);
+    for (int i = 0; i < dataSize; i++)
+    {
+        transferData[i] = (char) ((i * 2654435761u) >> 24);
+    }
+
+    theRunner.timeCase("checksumXXH64", dataSize, [&transferData]() {
+        StreamChecksum theChecksum(ChecksumType::XXH64);
+        for (int chunkStart = 0; chunkStart < transferData.size(); chunkStart += STREAM_CHUNK_SIZE)
+        {
+            theChecksum.addData(transferData.constData() + chunkStart, qMin(STREAM_CHUNK_SIZE, transferData.size() - chunkStart));
+        }
+        benchSink += theChecksum.getResult().size();
+    });
+
+    theRunner.timeCase("checksumMD5", dataSize, [&transferData]() {
+        StreamChecksum theChecksum(ChecksumType::MD5);
+        for (int chunkStart = 0; chunkStart < transferData.size(); chunkStart += STREAM_CHUNK_SIZE)
+        {
+            theChecksum.addData(transferData.constData() + chunkStart, qMin(STREAM_CHUNK_SIZE, transferData.size() - chunkStart));
+        }
+        benchSink += theChecksum.getResult().size();
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication benchLoop(argc, argv);
+
+    QString baselineFile;
+    QString newBaselineFile;
+    QString caseFilter;
+    double tolerance = 0.2;
+    qint64 maxSize = 1000000;
+
+    for (int i = 0; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i],"baseline") == 0)
+        {
+            baselineFile = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"writeBaseline") == 0)
+        {
+            newBaselineFile = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"tolerance") == 0)
+        {
+            tolerance = QString(argv[i+1]).toDouble();
+        }
+        if (strcmp(argv[i],"maxSize") == 0)
+        {
+            maxSize = QString(argv[i+1]).toLongLong();
+        }
+        if (strcmp(argv[i],"filter") == 0)
+        {
+            caseFilter = QString(argv[i+1]);
+        }
+    }
+
+    BenchRunner theRunner(maxSize, caseFilter);
+    runFolderNameCases(theRunner);
+    runAppListCases(theRunner);
+    runListingCases(theRunner);
+    runChecksumCases(theRunner);
+
+    QJsonDocument benchResults = theRunner.getResults();
+    QTextStream(stdout) << benchResults.toJson();
+
+    if (!newBaselineFile.isEmpty())
+    {
+        QFile baselineData(newBaselineFile);
+        if (!baselineData.open(QIODevice::WriteOnly) || (baselineData.write(benchResults.toJson()) < 0))
+        {
+            QTextStream(stderr) << "Unable to write baseline file: " << newBaselineFile << endl;
+            return 1;
+        }
+    }
+
+    if (theRunner.getFailureCount() > 0)
+    {
+        QTextStream(stderr) << theRunner.getFailureCount() << " cases gave wrong results" << endl;
+        return 1;
+    }
+
+    if (!baselineFile.isEmpty())
+    {
+        return theRunner.compareWithBaseline(baselineFile, tolerance);
+    }
+    return 0;
+}
@@ -0,0 +1,923 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+/* In-process load test of the client stack, for N virtual users at once.
+ *
+ * Each virtual user is its own AgaveSession, with its own credentials, handler and operators, as in the headless runner.
+ * After logging in, each user repeats a mix of actions, with a random think time between them:
+ * browse (list the home folder), poll (job details of a submitted job, or the job list), upload (a small file) and submit (a job).
+ *
+ * The test is meant to be run against a local stand-in for the Agave server, which accepts any login. It should never be pointed at a production tenant.
+ *
+ * Arguments:
+ * host <url>              Base URL of the stand-in server (required)
+ * users <n,n,...>         Numbers of virtual users to run, one step each, default 1,10,50
+ * duration <seconds>      Length of each step, after all users have logged in, default 60
+ * thinkMs <ms>            Mean pause between one user's actions, default 1000
+ * mix <b,p,u,s>           Relative weights of browse, poll, upload and submit, default 50,30,10,10
+ * networkThreads <n>      Network threads shared by the sessions, default 4
+ * uploadKB <n>            Size of the uploaded file, default 64
+ * app <id>                Agave app ID used for submits, default cwe-serial-0.2.0
+ * userPrefix <text>       Usernames are this prefix followed by a number, default loaduser
+ * password <text>         Password for every user, default loadpass
+ * loginTimeout <seconds>  Time allowed for logins, after which users not yet logged in are left out of the step, default 30
+ * multipartMB <n>         After the load steps, also check a multipart upload of a file this size, default 0 (no check)
+ * partMB <n>              Part size for the multipart check, default 1
+ * assemblyApp <id>        Agave app ID which joins the uploaded parts, default assemble-parts-0.1
+ *
+ * One JSON entry per step is printed to stdout, with the request rate, latency percentiles, memory and CPU time per HTTP request.
+ * Progress goes to stderr. Memory is only measured on Linux.
+ *
+ * Memory is reported both as the resident size at the start and end of the step, and as the growth per user during the step.
+ * Steps run in one process, so a later step starts from a heap grown by the earlier ones. For a clean per-user figure, run one user count per invocation.
+ *
+ * The multipart check uploads one file through a MultipartUploader, as the explorer does for large files. Once the first parts are underway, they are cut off, so that they must be retried.
+ * The check passes if the file is split into the expected parts, the cut off parts are retried, and the job to join the parts is submitted.
+ * A second upload of the same file is then cancelled after it starts, and every part it sent must be removed. The stand-in server must accept removal of any file.
+ * The result is printed as a "multipart" entry, and the exit code is 1 if the check failed.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <random>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+#include "remotedatainterface.h"
+#include "filemetadata.h"
+#include "remotejobdata.h"
+#include "agaveInterfaces/agavehandler.h"
+
+#include "utilFuncs/agavesession.h"
+#include "utilFuncs/multipartuploader.h"
+#include "utilFuncs/trafficnetmanager.h"
+
+static const int DRAIN_LIMIT_MS = 10000;
+static const int DRAIN_CHECK_MS = 100;
+static const int MULTIPART_LIMIT_MS = 120000;
+static const int MULTIPART_PARALLEL = 2;
+
+enum class LoadAction {BROWSE, POLL, UPLOAD, SUBMIT};
+static const int LOAD_ACTION_COUNT = 4;
+static const char * LOAD_ACTION_NAMES[] = {"browse", "poll", "upload", "submit"};
+
+struct LoadSettings
+{
+    QString host;
+    QList<int> userCounts = {1, 10, 50};
+    int durationSec = 60;
+    int thinkMs = 1000;
+    QVector<int> actionMix = {50, 30, 10, 10};
+    int networkThreads = 4;
+    int uploadKB = 64;
+    QString appID = "cwe-serial-0.2.0";
+    QString userPrefix = "loaduser";
+    QString password = "loadpass";
+    int loginTimeoutSec = 30;
+    int multipartMB = 0;
+    int partMB = 1;
+    QString assemblyAppID = "assemble-parts-0.1";
+    QString uploadFileName;
+};
+
+static qint64 processCpuMs()
+{
+#ifdef Q_OS_UNIX
+    struct rusage processUsage;
+    if (getrusage(RUSAGE_SELF, &processUsage) != 0) return -1;
+    return (processUsage.ru_utime.tv_sec + processUsage.ru_stime.tv_sec) * 1000 +
+            (processUsage.ru_utime.tv_usec + processUsage.ru_stime.tv_usec) / 1000;
+#elif defined(Q_OS_WIN)
+    FILETIME createTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &kernelTime, &userTime)) return -1;
+    quint64 kernelTicks = (((quint64) kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    quint64 userTicks = (((quint64) userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+    return (qint64) ((kernelTicks + userTicks) / 10000);
+#else
+    return -1;
+#endif
+}
+
+static qint64 residentBytes()
+{
+#ifdef Q_OS_LINUX
+    QFile statFile("/proc/self/statm");
+    if (!statFile.open(QIODevice::ReadOnly)) return -1;
+    QList<QByteArray> statFields = statFile.readAll().split(' ');
+    if (statFields.size() < 2) return -1;
+    return statFields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+/*! \brief LoadStats collects the latency of every action finished during a load step.
+ */
+
+class LoadStats
+{
+public:
+    void reset()
+    {
+        for (int i = 0; i < LOAD_ACTION_COUNT; i++)
+        {
+            latencyList[i].clear();
+            failCount[i] = 0;
+        }
+        recording = true;
+    }
+
+    void addSample(LoadAction theAction, qint64 latencyUs, bool succeeded)
+    {
+        if (!recording) return;
+        int actionIndex = (int) theAction;
+        latencyList[actionIndex].append(latencyUs);
+        if (!succeeded) failCount[actionIndex]++;
+    }
+
+    void stopRecording()
+    {
+        recording = false;
+    }
+
+    int getActionCount()
+    {
+        int totalCount = 0;
+        for (int i = 0; i < LOAD_ACTION_COUNT; i++) totalCount += latencyList[i].size();
+        return totalCount;
+    }
+
+    QJsonObject getLatencyJson(int actionIndex)
+    {
+        QVector<qint64> latencies;
+        if (actionIndex < 0)
+        {
+            for (int i = 0; i < LOAD_ACTION_COUNT; i++) latencies += latencyList[i];
+        }
+        else
+        {
+            latencies = latencyList[actionIndex];
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        QJsonObject latencyObject;
+        latencyObject.insert("count", latencies.size());
+        if (actionIndex >= 0) latencyObject.insert("failed", failCount[actionIndex]);
+        latencyObject.insert("p50Ms", percentileMs(latencies, 0.50));
+        latencyObject.insert("p95Ms", percentileMs(latencies, 0.95));
+        latencyObject.insert("p99Ms", percentileMs(latencies, 0.99));
+        latencyObject.insert("maxMs", latencies.isEmpty() ? 0.0 : latencies.last() / 1000.0);
+        return latencyObject;
+    }
+
+private:
+    static double percentileMs(const QVector<qint64> &sortedLatencies, double fraction)
+    {
+        if (sortedLatencies.isEmpty()) return 0;
+        int sampleIndex = qMin(sortedLatencies.size() - 1, (int) (fraction * sortedLatencies.size()));
+        return sortedLatencies.at(sampleIndex) / 1000.0;
+    }
+
+    QVector<qint64> latencyList[LOAD_ACTION_COUNT];
+    int failCount[LOAD_ACTION_COUNT] = {0, 0, 0, 0};
+    bool recording = false;
+};
+
+/*! \brief A VirtualUser repeats a random mix of actions through its own session, one at a time, until stopped.
+ */
+
+class VirtualUser : public QObject
+{
+    Q_OBJECT
+
+public:
+    VirtualUser(QString userName, int userNumber, AgaveSession * theSession, LoadStats * theStats, const LoadSettings &theSettings, QObject *parent = nullptr) :
+        QObject(parent), mySettings(theSettings), randomSource(userNumber)
+    {
+        myUserName = userName;
+        mySession = theSession;
+        myStats = theStats;
+
+        thinkTimer.setSingleShot(true);
+        QObject::connect(&thinkTimer, SIGNAL(timeout()), this, SLOT(nextAction()));
+    }
+
+    void startActions()
+    {
+        running = true;
+        scheduleAction();
+    }
+
+    void stopActions()
+    {
+        running = false;
+        thinkTimer.stop();
+    }
+
+    bool isIdle()
+    {
+        return !actionPending;
+    }
+
+private slots:
+    void nextAction()
+    {
+        if (!running) return;
+
+        QString homeFolder = "/" + myUserName;
+        RemoteDataInterface * theConnection = mySession->getDataConnection();
+        RemoteDataReply * theReply = nullptr;
+        currentAction = pickAction();
+        actionTimer.start();
+
+        if (currentAction == LoadAction::BROWSE)
+        {
+            theReply = theConnection->remoteLS(homeFolder);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveLSReply(RequestState,QList<FileMetaData>)), this, SLOT(actionReply(RequestState)));
+        }
+        else if ((currentAction == LoadAction::POLL) && !submittedJobs.isEmpty())
+        {
+            QString jobID = submittedJobs.at(randomSource() % submittedJobs.size());
+            theReply = theConnection->getJobDetails(jobID);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveJobDetails(RequestState,RemoteJobData)), this, SLOT(actionReply(RequestState)));
+        }
+        else if (currentAction == LoadAction::POLL)
+        {
+            theReply = theConnection->getListOfJobs();
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveJobList(RequestState,QList<RemoteJobData>)), this, SLOT(actionReply(RequestState)));
+        }
+        else if (currentAction == LoadAction::UPLOAD)
+        {
+            theReply = theConnection->uploadFile(homeFolder, mySettings.uploadFileName);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveUploadReply(RequestState,FileMetaData)), this, SLOT(actionReply(RequestState)));
+        }
+        else
+        {
+            QMultiMap<QString, QString> jobParams;
+            jobParams.insert("stage", "mesh");
+            jobParams.insert("directory", homeFolder);
+            theReply = theConnection->runRemoteJob("loadtest-app", jobParams, homeFolder);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveJobReply(RequestState,QJsonDocument)), this, SLOT(submitReply(RequestState,QJsonDocument)));
+        }
+
+        if (theReply == nullptr)
+        {
+            myStats->addSample(currentAction, 0, false);
+            scheduleAction();
+            return;
+        }
+        actionPending = true;
+    }
+
+    void actionReply(RequestState replyState)
+    {
+        finishAction(replyState == RequestState::GOOD);
+    }
+
+    void submitReply(RequestState replyState, QJsonDocument rawReply)
+    {
+        QString jobID = rawReply.object().value("result").toObject().value("id").toString();
+        if (!jobID.isEmpty()) submittedJobs.append(jobID);
+        finishAction((replyState == RequestState::GOOD) && !jobID.isEmpty());
+    }
+
+private:
+    LoadAction pickAction()
+    {
+        int totalWeight = 0;
+        for (int aWeight : mySettings.actionMix) totalWeight += aWeight;
+        int pick = randomSource() % qMax(1, totalWeight);
+
+        for (int i = 0; i < LOAD_ACTION_COUNT; i++)
+        {
+            if (pick < mySettings.actionMix.at(i)) return (LoadAction) i;
+            pick -= mySettings.actionMix.at(i);
+        }
+        return LoadAction::BROWSE;
+    }
+
+    void finishAction(bool succeeded)
+    {
+        if (!actionPending) return;
+        actionPending = false;
+        myStats->addSample(currentAction, actionTimer.nsecsElapsed() / 1000, succeeded);
+        scheduleAction();
+    }
+
+    void scheduleAction()
+    {
+        if (!running) return;
+
+        //Think times are spread around the mean, so that users do not fall into step
+        int thinkTime = mySettings.thinkMs / 2 + (int) (randomSource() % (quint32) qMax(1, mySettings.thinkMs));
+        thinkTimer.start(thinkTime);
+    }
+
+    QString myUserName;
+    AgaveSession * mySession;
+    LoadStats * myStats;
+    const LoadSettings &mySettings;
+
+    std::mt19937 randomSource;
+    QTimer thinkTimer;
+    QElapsedTimer actionTimer;
+    LoadAction currentAction = LoadAction::BROWSE;
+    bool running = false;
+    bool actionPending = false;
+    QStringList submittedJobs;
+};
+
+/*! \brief The MultipartCheck uploads one file in parts through its own session, forcing part retries, then cancels a second upload and waits for its parts to be removed.
+ */
+
+class MultipartCheck : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MultipartCheck(const LoadSettings &theSettings, QObject *parent = nullptr) : QObject(parent), mySettings(theSettings)
+    {
+        myUserName = QString("%1mp").arg(mySettings.userPrefix);
+        myPartSize = ((qint64) qMax(1, mySettings.partMB)) * 1024 * 1024;
+        myFileSize = ((qint64) qMax(1, mySettings.multipartMB)) * 1024 * 1024;
+
+        limitTimer.setSingleShot(true);
+        QObject::connect(&limitTimer, SIGNAL(timeout()), this, SLOT(checkTimedOut()));
+        QObject::connect(&removalTimer, SIGNAL(timeout()), this, SLOT(checkRemovals()));
+    }
+
+    ~MultipartCheck()
+    {
+        delete uploader;
+        delete cancelledUploader;
+        if (sessionPool != nullptr) delete sessionPool;
+    }
+
+    void startCheck()
+    {
+        QTextStream(stderr) << "Starting multipart check of " << myFileSize / 1024 / 1024 << " MB" << endl;
+        limitTimer.start(MULTIPART_LIMIT_MS);
+
+        //The parts differ, so that a part sent in the wrong place would not pass unnoticed
+        if (!partData.open())
+        {
+            finishCheck(false, "Unable to create multipart upload file.");
+            return;
+        }
+        QByteArray blockData(64 * 1024, 0);
+        for (qint64 written = 0; written < myFileSize; written += blockData.size())
+        {
+            blockData.fill('a' + (char) ((written / myPartSize) % 26));
+            partData.write(blockData.constData(), qMin((qint64) blockData.size(), myFileSize - written));
+        }
+        partData.flush();
+
+        sessionPool = new AgaveSessionPool(1);
+        mySession = sessionPool->createSession(myUserName);
+        mySession->setConnectionParams(mySettings.host, "SimCenter_CWE_GUI", "designsafe.storage.default");
+
+        AgaveHandler * theHandler = qobject_cast<AgaveHandler *>(mySession->getDataConnection());
+        if (theHandler != nullptr)
+        {
+            theHandler->registerAgaveAppInfo("assemble-parts", mySettings.assemblyAppID, {"directory", "parts", "checksums", "output"}, {}, "directory");
+        }
+
+        RemoteDataReply * authReply = mySession->performAuth(myUserName, mySettings.password);
+        if (authReply == nullptr)
+        {
+            finishCheck(false, "Unable to log in for the multipart check.");
+            return;
+        }
+        QObject::connect(authReply, SIGNAL(haveAuthReply(RequestState)), this, SLOT(loginReply(RequestState)));
+    }
+
+signals:
+    void checkDone(QJsonObject checkResult, bool passed);
+
+private slots:
+    void loginReply(RequestState replyState)
+    {
+        if (replyState != RequestState::GOOD)
+        {
+            finishCheck(false, "Unable to log in for the multipart check.");
+            return;
+        }
+
+        uploader = newUploader();
+        QObject::connect(uploader, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(uploadProgress(qint64,qint64)));
+        QObject::connect(uploader, SIGNAL(uploadFinished(bool,QString)), this, SLOT(uploadFinished(bool,QString)));
+
+        QString errorText;
+        if (!uploader->start(&errorText)) finishCheck(false, errorText);
+    }
+
+    void uploadProgress(qint64 bytesSent, qint64 bytesTotal)
+    {
+        //The parts in flight are cut off once, which the uploader should treat like any other failed part
+        if (partsCutOff || (bytesSent >= bytesTotal)) return;
+        partsCutOff = true;
+        QMetaObject::invokeMethod(mySession->getNetManager(), "abortBulkTransfers", Qt::QueuedConnection);
+    }
+
+    void uploadFinished(bool succeeded, QString message)
+    {
+        int expectedParts = (int) ((myFileSize + myPartSize - 1) / myPartSize);
+
+        myResult.insert("bytes", myFileSize);
+        myResult.insert("partBytes", myPartSize);
+        myResult.insert("expectedParts", expectedParts);
+        myResult.insert("parts", uploader->getPartCount());
+        myResult.insert("retries", uploader->getRetryCount());
+        myResult.insert("assemblySubmitted", succeeded);
+        myResult.insert("message", message);
+        myResult.insert("uploadMs", checkClock.elapsed());
+
+        QStringList problemList;
+        if (uploader->getPartCount() != expectedParts) problemList.append("wrong number of parts");
+        if (uploader->getRetryCount() == 0) problemList.append("no part was retried");
+        if (!succeeded) problemList.append("upload or assembly job failed");
+        if (!problemList.isEmpty())
+        {
+            finishCheck(false, problemList.join(", "));
+            return;
+        }
+
+        //The parts sent before the cancel are the first ones, up to the number sent at once
+        cancelledUploader = newUploader();
+        QObject::connect(cancelledUploader, &MultipartUploader::uploadProgress, [this]() {
+            if (cancelledParts > 0) return;
+            cancelledParts = qMin(MULTIPART_PARALLEL, cancelledUploader->getPartCount());
+            cancelledUploader->cancel();
+            removalTimer.start(DRAIN_CHECK_MS);
+        });
+
+        QString errorText;
+        if (!cancelledUploader->start(&errorText)) finishCheck(false, errorText);
+    }
+
+    void checkRemovals()
+    {
+        if (cancelledUploader->getRemovedPartCount() < cancelledParts) return;
+        removalTimer.stop();
+        finishCheck(true, QString());
+    }
+
+    void checkTimedOut()
+    {
+        finishCheck(false, QString("Multipart check did not finish in %1 s").arg(MULTIPART_LIMIT_MS / 1000));
+    }
+
+private:
+    MultipartUploader * newUploader()
+    {
+        checkClock.start();
+        MultipartUploader * newUpload = new MultipartUploader(partData.fileName(), "/" + myUserName, myPartSize, MULTIPART_PARALLEL);
+        newUpload->setConnection(mySession->getDataConnection(), mySession->getNetManager(), "designsafe.storage.default");
+        return newUpload;
+    }
+
+    void finishCheck(bool passed, QString problem)
+    {
+        if (checkFinished) return;
+        checkFinished = true;
+        limitTimer.stop();
+        removalTimer.stop();
+
+        if (cancelledUploader != nullptr)
+        {
+            myResult.insert("cancelledParts", cancelledParts);
+            myResult.insert("removedParts", cancelledUploader->getRemovedPartCount());
+        }
+        myResult.insert("passed", passed);
+        if (!passed)
+        {
+            myResult.insert("problem", problem);
+            QTextStream(stderr) << "Multipart check failed: " << problem << endl;
+        }
+        emit checkDone(myResult, passed);
+    }
+
+    const LoadSettings &mySettings;
+    QString myUserName;
+    qint64 myPartSize;
+    qint64 myFileSize;
+
+    QTemporaryFile partData;
+    AgaveSessionPool * sessionPool = nullptr;
+    AgaveSession * mySession = nullptr;
+    MultipartUploader * uploader = nullptr;
+    MultipartUploader * cancelledUploader = nullptr;
+
+    QTimer limitTimer;
+    QTimer removalTimer;
+    QElapsedTimer checkClock;
+    bool partsCutOff = false;
+    int cancelledParts = 0;
+    bool checkFinished = false;
+    QJsonObject myResult;
+};
+
+/*! \brief The LoadTestRunner runs one load step for each number of users, and reports each step as it ends.
+ */
+
+class LoadTestRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoadTestRunner(LoadSettings theSettings, QObject *parent = nullptr) : QObject(parent)
+    {
+        mySettings = theSettings;
+
+        stepTimer.setSingleShot(true);
+        QObject::connect(&stepTimer, SIGNAL(timeout()), this, SLOT(endStep()));
+        loginLimitTimer.setSingleShot(true);
+        QObject::connect(&loginLimitTimer, SIGNAL(timeout()), this, SLOT(loginTimedOut()));
+        QObject::connect(&drainTimer, SIGNAL(timeout()), this, SLOT(checkDrained()));
+    }
+
+    ~LoadTestRunner()
+    {
+        clearStep();
+    }
+
+public slots:
+    void runNextStep()
+    {
+        if ((stepIndex >= mySettings.userCounts.size()) && (mySettings.multipartMB > 0) && (multipartCheck == nullptr))
+        {
+            multipartCheck = new MultipartCheck(mySettings, this);
+            QObject::connect(multipartCheck, SIGNAL(checkDone(QJsonObject,bool)), this, SLOT(multipartDone(QJsonObject,bool)));
+            multipartCheck->startCheck();
+            return;
+        }
+        if (stepIndex >= mySettings.userCounts.size())
+        {
+            QJsonObject rootObject;
+            rootObject.insert("loadSteps", stepResults);
+            if (!multipartResult.isEmpty()) rootObject.insert("multipart", multipartResult);
+            QTextStream(stdout) << QJsonDocument(rootObject).toJson();
+            QCoreApplication::exit(multipartPassed ? 0 : 1);
+            return;
+        }
+
+        int userCount = mySettings.userCounts.at(stepIndex);
+        QTextStream(stderr) << "Starting " << userCount << " virtual users" << endl;
+
+        baseResident = residentBytes();
+        sessionPool = new AgaveSessionPool(mySettings.networkThreads);
+        loginTimer.start();
+
+        for (int i = 0; i < userCount; i++)
+        {
+            QString userName = QString("%1%2").arg(mySettings.userPrefix).arg(i + 1);
+            AgaveSession * newSession = sessionPool->createSession(userName);
+            newSession->setConnectionParams(mySettings.host, "SimCenter_CWE_GUI", "designsafe.storage.default");
+
+            AgaveHandler * theHandler = qobject_cast<AgaveHandler *>(newSession->getDataConnection());
+            if (theHandler != nullptr)
+            {
+                theHandler->registerAgaveAppInfo("loadtest-app", mySettings.appID, {"stage"}, {"directory"}, "directory");
+            }
+
+            userList.append(new VirtualUser(userName, i + 1, newSession, &myStats, mySettings, this));
+
+            RemoteDataReply * authReply = newSession->performAuth(userName, mySettings.password);
+            if (authReply == nullptr) continue;
+            pendingLogins.insert(authReply, userList.last());
+            QObject::connect(authReply, SIGNAL(haveAuthReply(RequestState)), this, SLOT(loginReply(RequestState)));
+        }
+
+        if (pendingLogins.isEmpty())
+        {
+            startMeasuring();
+            return;
+        }
+        loginLimitTimer.start(mySettings.loginTimeoutSec * 1000);
+    }
+
+private slots:
+    void multipartDone(QJsonObject checkResult, bool passed)
+    {
+        multipartResult = checkResult;
+        multipartPassed = passed;
+        QTimer::singleShot(0, this, SLOT(runNextStep()));
+    }
+
+    void loginReply(RequestState replyState)
+    {
+        VirtualUser * theUser = pendingLogins.take(sender());
+        if (theUser == nullptr) return;
+        if (replyState == RequestState::GOOD)
+        {
+            loggedInUsers.append(theUser);
+        }
+
+        if (pendingLogins.isEmpty()) startMeasuring();
+    }
+
+    void loginTimedOut()
+    {
+        //Replies which arrive later find no pending login, and are ignored
+        if (pendingLogins.isEmpty()) return;
+        QTextStream(stderr) << pendingLogins.size() << " logins did not reply in " << mySettings.loginTimeoutSec << " s" << endl;
+        loginTimeouts = pendingLogins.size();
+        pendingLogins.clear();
+        startMeasuring();
+    }
+
+    void endStep()
+    {
+        myStats.stopRecording();
+        measureTime = measureTimer.elapsed();
+        measureCpu = processCpuMs() - startCpu;
+        measureRequests = getRequestTotal() - startRequests;
+        measureResident = residentBytes();
+
+        for (VirtualUser * aUser : loggedInUsers)
+        {
+            aUser->stopActions();
+        }
+        drainClock.start();
+        drainTimer.start(DRAIN_CHECK_MS);
+    }
+
+    void checkDrained()
+    {
+        //Replies still in flight are let through, so the sessions are not torn down under them
+        bool allIdle = true;
+        for (VirtualUser * aUser : loggedInUsers)
+        {
+            if (!aUser->isIdle()) allIdle = false;
+        }
+        if (!allIdle && (drainClock.elapsed() < DRAIN_LIMIT_MS)) return;
+        drainTimer.stop();
+
+        reportStep();
+        clearStep();
+        stepIndex++;
+        QTimer::singleShot(0, this, SLOT(runNextStep()));
+    }
+
+private:
+    void startMeasuring()
+    {
+        loginLimitTimer.stop();
+        QTextStream(stderr) << loggedInUsers.size() << " of " << userList.size() << " users logged in after " << loginTimer.elapsed() << " ms" << endl;
+        loginTime = loginTimer.elapsed();
+
+        myStats.reset();
+        startCpu = processCpuMs();
+        startRequests = getRequestTotal();
+        measureTimer.start();
+
+        for (VirtualUser * aUser : loggedInUsers)
+        {
+            aUser->startActions();
+        }
+        stepTimer.start(mySettings.durationSec * 1000);
+    }
+
+    qint64 getRequestTotal()
+    {
+        qint64 requestTotal = 0;
+        if (sessionPool == nullptr) return 0;
+        for (AgaveSession * aSession : sessionPool->getSessions())
+        {
+            requestTotal += aSession->getNetManager()->getRequestCount();
+        }
+        return requestTotal;
+    }
+
+    void reportStep()
+    {
+        int userCount = userList.size();
+        double elapsedSec = qMax((qint64) 1, measureTime) / 1000.0;
+
+        QJsonObject stepObject;
+        stepObject.insert("users", userCount);
+        stepObject.insert("loggedIn", loggedInUsers.size());
+        stepObject.insert("loginMs", loginTime);
+        stepObject.insert("loginTimeouts", loginTimeouts);
+        stepObject.insert("seconds", elapsedSec);
+        stepObject.insert("actionsPerSec", myStats.getActionCount() / elapsedSec);
+        stepObject.insert("httpRequests", measureRequests);
+        stepObject.insert("requestsPerSec", measureRequests / elapsedSec);
+        stepObject.insert("latency", myStats.getLatencyJson(-1));
+
+        QJsonObject actionObject;
+        for (int i = 0; i < LOAD_ACTION_COUNT; i++)
+        {
+            actionObject.insert(LOAD_ACTION_NAMES[i], myStats.getLatencyJson(i));
+        }
+        stepObject.insert("actions", actionObject);
+
+        if ((measureCpu >= 0) && (measureRequests > 0))
+        {
+            stepObject.insert("cpuMsPerRequest", (double) measureCpu / measureRequests);
+        }
+        if ((baseResident >= 0) && (measureResident >= 0))
+        {
+            stepObject.insert("residentStartKB", baseResident / 1024.0);
+            stepObject.insert("residentEndKB", measureResident / 1024.0);
+            if (userCount > 0) stepObject.insert("residentKBPerUser", (measureResident - baseResident) / 1024.0 / userCount);
+        }
+        stepResults.append(stepObject);
+
+        QJsonObject overallLatency = myStats.getLatencyJson(-1);
+        QTextStream(stderr) << QString("%1 users: %2 req/s, p50 %3 ms, p99 %4 ms")
+                               .arg(userCount).arg(measureRequests / elapsedSec, 0, 'f', 1)
+                               .arg(overallLatency.value("p50Ms").toDouble(), 0, 'f', 1)
+                               .arg(overallLatency.value("p99Ms").toDouble(), 0, 'f', 1) << endl;
+    }
+
+    void clearStep()
+    {
+        qDeleteAll(userList);
+        userList.clear();
+        loggedInUsers.clear();
+        pendingLogins.clear();
+        loginLimitTimer.stop();
+        loginTimeouts = 0;
+
+        if (sessionPool != nullptr) delete sessionPool;
+        sessionPool = nullptr;
+    }
+
+    LoadSettings mySettings;
+    int stepIndex = 0;
+    QJsonArray stepResults;
+
+    MultipartCheck * multipartCheck = nullptr;
+    QJsonObject multipartResult;
+    bool multipartPassed = true;
+
+    AgaveSessionPool * sessionPool = nullptr;
+    QList<VirtualUser *> userList;
+    QList<VirtualUser *> loggedInUsers;
+    QMap<QObject *, VirtualUser *> pendingLogins;
+    LoadStats myStats;
+
+    QTimer stepTimer;
+    QTimer loginLimitTimer;
+    QTimer drainTimer;
+    QElapsedTimer drainClock;
+    QElapsedTimer loginTimer;
+    QElapsedTimer measureTimer;
+
+    qint64 loginTime = 0;
+    int loginTimeouts = 0;
+    qint64 baseResident = -1;
+    qint64 startCpu = 0;
+    qint64 startRequests = 0;
+    qint64 measureTime = 0;
+    qint64 measureCpu = -1;
+    qint64 measureRequests = 0;
+    qint64 measureResident = -1;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication loadLoop(argc, argv);
+
+    LoadSettings theSettings;
+    for (int i = 0; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i],"host") == 0)
+        {
+            theSettings.host = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"users") == 0)
+        {
+            theSettings.userCounts.clear();
+            for (QString aCount : QString(argv[i+1]).split(',', QString::SkipEmptyParts))
+            {
+                if (aCount.toInt() > 0) theSettings.userCounts.append(aCount.toInt());
+            }
+        }
+        if (strcmp(argv[i],"duration") == 0)
+        {
+            theSettings.durationSec = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"thinkMs") == 0)
+        {
+            theSettings.thinkMs = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"mix") == 0)
+        {
+            QStringList mixWeights = QString(argv[i+1]).split(',');
+            for (int j = 0; (j < mixWeights.size()) && (j < LOAD_ACTION_COUNT); j++)
+            {
+                theSettings.actionMix[j] = qMax(0, mixWeights.at(j).toInt());
+            }
+        }
+        if (strcmp(argv[i],"networkThreads") == 0)
+        {
+            theSettings.networkThreads = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"uploadKB") == 0)
+        {
+            theSettings.uploadKB = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"app") == 0)
+        {
+            theSettings.appID = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"userPrefix") == 0)
+        {
+            theSettings.userPrefix = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"password") == 0)
+        {
+            theSettings.password = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"loginTimeout") == 0)
+        {
+            theSettings.loginTimeoutSec = qMax(1, QString(argv[i+1]).toInt());
+        }
+        if (strcmp(argv[i],"multipartMB") == 0)
+        {
+            theSettings.multipartMB = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"partMB") == 0)
+        {
+            theSettings.partMB = qMax(1, QString(argv[i+1]).toInt());
+        }
+        if (strcmp(argv[i],"assemblyApp") == 0)
+        {
+            theSettings.assemblyAppID = QString(argv[i+1]);
+        }
+    }
+
+    if (theSettings.host.isEmpty() || theSettings.userCounts.isEmpty())
+    {
+        QTextStream(stderr) << "Usage: AgaveLoadTest host <url> [users <n,n,...>] [duration <seconds>] [thinkMs <ms>] [mix <b,p,u,s>] [multipartMB <n>] [partMB <n>]" << endl;
+        return 1;
+    }
+
+    //Every upload sends the same file
+    QTemporaryFile uploadData;
+    if (!uploadData.open())
+    {
+        QTextStream(stderr) << "Unable to create upload file." << endl;
+        return 1;
+    }
+    uploadData.write(QByteArray(qMax(1, theSettings.uploadKB) * 1024, 'x'));
+    uploadData.flush();
+    theSettings.uploadFileName = uploadData.fileName();
+
+    LoadTestRunner theRunner(theSettings);
+    QTimer::singleShot(0, &theRunner, SLOT(runNextStep()));
+    return loadLoop.exec();
+}
+
+#include "aeloadtest.moc"
@@ -35,8 +35,12 @@
 
 #include "explorerdriver.h"
 
+#include <QEvent>
+
 #include "explorerwindow.h"
 #include "utilFuncs/authform.h"
+#include "utilFuncs/transferjournal.h"
+#include "utilFuncs/stallwatchdog.h"
 #include "remoteFiles/fileoperator.h"
 #include "remoteJobs/joboperator.h"
 
@@ -54,6 +58,7 @@ ExplorerDriver::~ExplorerDriver()
 
 void ExplorerDriver::startup()
 {
+    startStallWatchdog();
     createAndStartAgaveThread();
 
     myDataInterface->registerAgaveAppInfo("compress", "compress-0.1u1",{"directory", "compression_type"},{},"directory");
@@ -62,15 +67,20 @@ void ExplorerDriver::startup()
     myDataInterface->registerAgaveAppInfo("cwe-serial", "cwe-serial-0.2.0", {"stage"}, {"file_input", "directory"}, "directory");
     myDataInterface->registerAgaveAppInfo("cwe-parallel", "cwe-parallel-0.2.0", {"stage"}, {"file_input", "directory"}, "directory");
 
+    //In fast startup, the style is scoped to each window, so only the login's widgets are styled before it is shown
     authWindow = new AuthForm();
+    if (fastStartup) authWindow->setStyleSheet(appStyleSheet);
     authWindow->show();
+    markStartupPoint("Login shown");
     QObject::connect(authWindow->windowHandle(),SIGNAL(visibleChanged(bool)),this, SLOT(subWindowHidden(bool)));
 }
 
 void ExplorerDriver::closeAuthScreen()
 {
     mainWindow = new ExplorerWindow();
+    if (fastStartup) mainWindow->setStyleSheet(appStyleSheet);
     mainWindow->startAndShow();
+    markStartupPoint("Main window shown");
 
     //The dynamics of this may be different in windows. TODO: Find a more cross-platform solution
     QObject::connect(mainWindow->windowHandle(),SIGNAL(visibleChanged(bool)),this, SLOT(subWindowHidden(bool)));
@@ -86,6 +96,8 @@ void ExplorerDriver::closeAuthScreen()
     AgaveTaskReply * agaveList = myDataInterface->getAgaveAppList();
 
     QObject::connect(agaveList, SIGNAL(haveAgaveAppList(RequestState,QVariantList)), this, SLOT(loadAppList(RequestState,QVariantList)));
+
+    myTransferJournal->offerResume();
 }
 
 QString ExplorerDriver::getBanner()
@@ -100,20 +112,17 @@ QString ExplorerDriver::getVersion()
 
 void ExplorerDriver::loadAppList(RequestState replyState, QVariantList appList)
 {
+    StallWatchdog::HandlerMark mark("ExplorerDriver::loadAppList");
+
     if (replyState != RequestState::GOOD)
     {
         qCDebug(agaveAppLayer, "App List not available.");
         return;
     }
 
-    for (auto itr = appList.constBegin(); itr != appList.constEnd(); itr++)
+    for (QString appName : ae_globals::parseAppNames(appList))
     {
-        QString appName = (*itr).toJsonObject().value("name").toString();
-
-        if (!appName.isEmpty())
-        {
-            mainWindow->addAppToList(appName);
-        }
+        mainWindow->addAppToList(appName);
     }
 }
 
@@ -124,7 +133,29 @@ void ExplorerDriver::loadStyleFiles()
     {
         ae_globals::displayFatalPopup("Missing file for graphics style. Your install is probably corrupted.");
     }
-    QString commonStyle = QLatin1String(simCenterStyle.readAll());
+    appStyleSheet = QLatin1String(simCenterStyle.readAll());
 
-    qApp->setStyleSheet(commonStyle);
+    if (!fastStartup)
+    {
+        qApp->setStyleSheet(appStyleSheet);
+    }
+    else
+    {
+        qApp->installEventFilter(this);
+    }
+    markStartupPoint("Style loaded");
+}
+
+bool ExplorerDriver::eventFilter(QObject * watched, QEvent * event)
+{
+    //In fast startup, windows without a parent do not inherit the style, so each is styled before its first paint
+    if ((event->type() == QEvent::Show) && watched->isWidgetType())
+    {
+        QWidget * shownWidget = static_cast<QWidget *>(watched);
+        if (shownWidget->isWindow() && (shownWidget->parentWidget() == nullptr) && shownWidget->styleSheet().isEmpty())
+        {
+            shownWidget->setStyleSheet(appStyleSheet);
+        }
+    }
+    return AgaveSetupDriver::eventFilter(watched, event);
 }
@@ -51,6 +51,9 @@ class ExplorerWindow;
  *  This class is the main contoller object for the other items in the AgaveExplorer. The AgaveExplorer program consists of creating an ExplorerDriver, running loadStyleFiles(), and then calling startup() before starting the Qt loop.
  *
  *  The Explorer driver is responsible to creating and removing subordinate program objects, most prominantly, the login and main windows. There should be only one driver object for the program.
+ *
+ *  With the fastStartup argument, the style sheet is set on each window rather than the whole application, and the main window builds its job and app panels on first use.
+ *  Other windows without a parent, such as popups and dialogs, are given the style sheet as they are shown.
  */
 class ExplorerDriver : public AgaveSetupDriver
 {
@@ -76,11 +79,15 @@ public:
     virtual QString getBanner();
     virtual QString getVersion();
 
+protected:
+    virtual bool eventFilter(QObject * watched, QEvent * event);
+
 private slots:
     void loadAppList(RequestState replyState, QVariantList appList);
 
 private:
     ExplorerWindow * mainWindow = nullptr;
+    QString appStyleSheet;
 };
 
 #endif // EXPLORERDRIVER_H
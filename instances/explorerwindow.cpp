@@ -36,6 +36,10 @@
 #include "explorerwindow.h"
 #include "ui_explorerwindow.h"
 
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <QTimer>
+
 #include "remotedatainterface.h"
 #include "filemetadata.h"
 
@@ -46,6 +50,17 @@
 #include "remoteJobs/joboperator.h"
 
 #include "utilFuncs/singlelinedialog.h"
+#include "utilFuncs/folderprefetcher.h"
+#include "utilFuncs/transferjournal.h"
+#include "utilFuncs/filebuffercache.h"
+#include "utilFuncs/joblistmodel.h"
+#include "utilFuncs/jobtaildialog.h"
+#include "utilFuncs/joboutputharvester.h"
+#include "utilFuncs/jobnotificationlistener.h"
+#include "utilFuncs/bulkfileoperation.h"
+#include "utilFuncs/localtreescanner.h"
+#include "utilFuncs/multipartuploader.h"
+#include "utilFuncs/stallwatchdog.h"
 
 #include "explorerdriver.h"
 #include "ae_globals.h"
@@ -63,13 +78,31 @@ ExplorerWindow::ExplorerWindow(QWidget *parent) :
     {
         taskListModel.appendRow(new QStandardItem(*itr));
     }
-    ui->agaveAppList->setModel(&taskListModel);
 
     ui->remoteFileView->linkToFileOperator(ae_globals::get_file_handle());
-    ui->jobTable->setOperator(ae_globals::get_job_handle());
+    ui->remoteFileView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    //Every entry is one line, so a large listing is laid out without asking each row for its height
+    ui->remoteFileView->setUniformRowHeights(true);
+    if (ae_globals::get_Driver()->prefetchIsEnabled())
+    {
+        folderPrefetcher = new FolderPrefetcher(ui->remoteFileView, this);
+    }
+
+    outputHarvester = new JobOutputHarvester("AgaveExplorer", this);
 
     ui->selectedFileLabel->connectFileTreeWidget(ui->remoteFileView);
     ui->selectedFileInfo->connectFileTreeWidget(ui->remoteFileView);
+
+    //In fast startup, only the file page is ready when the window is first shown
+    if (ae_globals::get_Driver()->fastStartupEnabled())
+    {
+        QObject::connect(ui->stackedView, SIGNAL(currentChanged(int)), this, SLOT(panelTabChanged(int)));
+    }
+    else
+    {
+        buildAppPanel();
+        buildJobPanel();
+    }
 }
 
 ExplorerWindow::~ExplorerWindow()
@@ -82,10 +115,6 @@ void ExplorerWindow::startAndShow()
     QObject::connect(ui->remoteFileView, SIGNAL(customContextMenuRequested(QPoint)),
                      this, SLOT(customFileMenu(QPoint)));
 
-    ui->agaveAppList->setModel(&taskListModel);
-    QObject::connect(ui->jobTable, SIGNAL(customContextMenuRequested(QPoint)),
-                     this, SLOT(jobRightClickMenu(QPoint)));
-
     //Note: Adding widget to header will re-parent them
     QLabel * username = new QLabel(ae_globals::get_connection()->getUserName());
     ui->header->appendWidget(username);
@@ -94,6 +123,48 @@ void ExplorerWindow::startAndShow()
     QObject::connect(logoutButton, SIGNAL(clicked(bool)), ae_globals::get_Driver(), SLOT(shutdown()));
     ui->header->appendWidget(logoutButton);
     this->show();
+
+    //Finished jobs are harvested through the job model, so it cannot wait for the jobs tab to be opened
+    if (!jobPanelBuilt)
+    {
+        QTimer::singleShot(JOB_PANEL_DEFER_MS, this, SLOT(buildJobPanel()));
+    }
+}
+
+void ExplorerWindow::panelTabChanged(int newIndex)
+{
+    QWidget * newPage = ui->stackedView->widget(newIndex);
+    if (newPage == ui->tab)
+    {
+        buildJobPanel();
+    }
+    else if (newPage == ui->AgavePassThru)
+    {
+        buildAppPanel();
+    }
+}
+
+void ExplorerWindow::buildAppPanel()
+{
+    if (appPanelBuilt) return;
+    appPanelBuilt = true;
+
+    ui->agaveAppList->setModel(&taskListModel);
+}
+
+void ExplorerWindow::buildJobPanel()
+{
+    if (jobPanelBuilt) return;
+    jobPanelBuilt = true;
+
+    jobModel = new JobListModel(ae_globals::get_job_handle(), this);
+    ui->jobTable->setModel(jobModel);
+    ui->jobTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui->jobTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    QObject::connect(jobModel, SIGNAL(jobListUpdated()), this, SLOT(jobListUpdated()));
+    QObject::connect(jobModel, SIGNAL(jobStateChanged(RemoteJobData)), this, SLOT(jobStateChanged(RemoteJobData)));
+    QObject::connect(ui->jobTable, SIGNAL(customContextMenuRequested(QPoint)),
+                     this, SLOT(jobRightClickMenu(QPoint)));
 }
 
 void ExplorerWindow::addAppToList(QString appName)
@@ -112,6 +183,8 @@ void ExplorerWindow::addAppToList(QString appName)
 
 void ExplorerWindow::agaveAppSelected(QModelIndex clickedItem)
 {
+    StallWatchdog::HandlerMark mark("ExplorerWindow::agaveAppSelected");
+
     QString newSelection = taskListModel.itemFromIndex(clickedItem)->text();
     if (selectedAgaveApp == newSelection)
     {
@@ -184,9 +257,15 @@ void ExplorerWindow::agaveCommandInvoked()
                      this, SLOT(finishedAppInvoke(RequestState,QJsonDocument)));
 }
 
-void ExplorerWindow::finishedAppInvoke(RequestState, QJsonDocument)
+void ExplorerWindow::finishedAppInvoke(RequestState finalState, QJsonDocument rawReply)
 {
     waitingOnCommand = false;
+
+    JobNotificationListener * notificationListener = ae_globals::get_Driver()->getNotificationListener();
+    if ((finalState == RequestState::GOOD) && (notificationListener != nullptr))
+    {
+        notificationListener->registerJob(rawReply.object().value("result").toObject().value("id").toString());
+    }
     ae_globals::get_job_handle()->demandJobDataRefresh();
 }
 
@@ -199,8 +278,24 @@ void ExplorerWindow::customFileMenu(QPoint pos)
         fileMenu.exec(QCursor::pos());
         return;
     }
+    if ((bulkOperation != nullptr) && bulkOperation->isRunning())
+    {
+        fileMenu.addAction("Bulk File Operation In Progress . . .");
+        fileMenu.exec(QCursor::pos());
+        return;
+    }
 
     QModelIndex targetIndex = ui->remoteFileView->indexAt(pos);
+    if (bulkMenuNeeded(targetIndex))
+    {
+        fileMenu.addAction(QString("Copy %1 Items To . . .").arg(bulkTargets.size()),this, SLOT(bulkCopyMenuItem()));
+        fileMenu.addAction(QString("Move %1 Items To . . .").arg(bulkTargets.size()),this, SLOT(bulkMoveMenuItem()));
+        fileMenu.addSeparator();
+        fileMenu.addAction(QString("Delete %1 Items").arg(bulkTargets.size()),this, SLOT(bulkDeleteMenuItem()));
+        fileMenu.exec(QCursor::pos());
+        return;
+    }
+
     ui->remoteFileView->fileEntryTouched(targetIndex);
 
     targetNode = ui->remoteFileView->getSelectedFile();
@@ -230,7 +325,7 @@ void ExplorerWindow::customFileMenu(QPoint pos)
     if (targetNode.getFileType() == FileType::FILE)
     {
         fileMenu.addAction("Download File",this, SLOT(downloadMenuItem()));
-        if (targetNode.fileBufferLoaded())
+        if (ae_globals::get_Driver()->getBufferCache()->haveBuffer(RemotePath(targetNode.getFullPath())))
         {
             fileMenu.addAction("Read File",this, SLOT(readMenuItem()));
         }
@@ -293,6 +388,81 @@ void ExplorerWindow::deleteMenuItem()
     }
 }
 
+void ExplorerWindow::bulkCopyMenuItem()
+{
+    SingleLineDialog destPopup("Please type the full path of the folder to copy to:", "");
+    if (destPopup.exec() != QDialog::Accepted)
+    {
+        return;
+    }
+    startBulkOperation(BulkOpType::COPY, destPopup.getInputText());
+}
+
+void ExplorerWindow::bulkMoveMenuItem()
+{
+    SingleLineDialog destPopup("Please type the full path of the folder to move to:", "");
+    if (destPopup.exec() != QDialog::Accepted)
+    {
+        return;
+    }
+    startBulkOperation(BulkOpType::MOVE, destPopup.getInputText());
+}
+
+void ExplorerWindow::bulkDeleteMenuItem()
+{
+    QMessageBox::StandardButton userAnswer = QMessageBox::question(this, "Delete Files",
+                                QString("Are you sure you want to delete these %1 items?").arg(bulkTargets.size()),
+                                QMessageBox::Yes | QMessageBox::No);
+    if (userAnswer != QMessageBox::Yes)
+    {
+        return;
+    }
+    startBulkOperation(BulkOpType::REMOVE, QString());
+}
+
+void ExplorerWindow::bulkOperationDone(int succeeded, int failed)
+{
+    if (failed > 0)
+    {
+        ae_globals::displayPopup(QString("%1 of %2 items could not be changed.").arg(failed).arg(succeeded + failed), "Bulk File Operation");
+    }
+    bulkOperation->deleteLater();
+    bulkOperation = nullptr;
+}
+
+bool ExplorerWindow::bulkMenuNeeded(QModelIndex clickedIndex)
+{
+    QModelIndexList selectedRows = ui->remoteFileView->selectionModel()->selectedRows();
+    if (selectedRows.size() < 2) return false;
+
+    //Right-clicking outside the selection acts on the clicked entry alone
+    bool clickedInSelection = false;
+    for (QModelIndex anIndex : selectedRows)
+    {
+        if ((anIndex.row() == clickedIndex.row()) && (anIndex.parent() == clickedIndex.parent()))
+        {
+            clickedInSelection = true;
+        }
+    }
+    if (!clickedInSelection) return false;
+
+    bulkTargets = BulkFileOperation::pathsFromSelection(selectedRows);
+    return (bulkTargets.size() > 1);
+}
+
+void ExplorerWindow::startBulkOperation(BulkOpType opType, QString destFolder)
+{
+    if (opType != BulkOpType::REMOVE)
+    {
+        QStringList destParts = destFolder.split('/', QString::SkipEmptyParts);
+        destFolder = QString("/").append(destParts.join('/'));
+    }
+
+    bulkOperation = new BulkFileOperation(opType, bulkTargets, destFolder, ae_globals::get_file_handle(), this);
+    QObject::connect(bulkOperation, SIGNAL(bulkOperationDone(int,int)), this, SLOT(bulkOperationDone(int,int)));
+    bulkOperation->start();
+}
+
 void ExplorerWindow::uploadMenuItem()
 {
     SingleLineDialog uploadNamePopup("Please input full path of file to upload:", "");
@@ -301,7 +471,41 @@ void ExplorerWindow::uploadMenuItem()
     {
         return;
     }
-    ae_globals::get_Driver()->getFileHandler()->sendUploadReq(targetNode, uploadNamePopup.getInputText());
+
+    //Files larger than a few parts go up in parallel parts, if there is an app to join them
+    AgaveSetupDriver * theDriver = ae_globals::get_Driver();
+    if (!theDriver->getAssemblyApp().isEmpty() && (largeUpload == nullptr) &&
+            (QFileInfo(uploadNamePopup.getInputText()).size() > 4 * theDriver->getUploadPartSize()))
+    {
+        largeUpload = new MultipartUploader(uploadNamePopup.getInputText(), targetNode.getFullPath(), theDriver->getUploadPartSize(), 4, this);
+        QObject::connect(largeUpload, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(largeUploadProgress(qint64,qint64)));
+        QObject::connect(largeUpload, SIGNAL(uploadFinished(bool,QString)), this, SLOT(largeUploadFinished(bool,QString)));
+
+        largeUploadDialog = new QProgressDialog(QString("Uploading %1").arg(uploadNamePopup.getInputText()), "Cancel", 0, 1000, this);
+        largeUploadDialog->setMinimumDuration(0);
+        QObject::connect(largeUploadDialog, &QProgressDialog::canceled, [this]() {
+            if (largeUpload == nullptr) return;
+            largeUpload->cancel();
+            largeUploadFinished(false, "Upload cancelled.");
+        });
+
+        QString errorText;
+        if (!largeUpload->start(&errorText))
+        {
+            largeUploadFinished(false, errorText);
+        }
+        return;
+    }
+
+    //A request made while another operation runs is refused, and must not be journaled
+    FileOperator * fileHandle = ae_globals::get_Driver()->getFileHandler();
+    if (fileHandle->operationIsPending())
+    {
+        ae_globals::displayPopup("File not uploaded. Another file operation is in progress.");
+        return;
+    }
+    fileHandle->sendUploadReq(targetNode, uploadNamePopup.getInputText());
+    ae_globals::get_Driver()->getTransferJournal()->noteTransferStarted(TransferType::UPLOAD_FILE, targetNode.getFullPath(), uploadNamePopup.getInputText());
 }
 
 void ExplorerWindow::uploadFolderMenuItem()
@@ -312,7 +516,78 @@ void ExplorerWindow::uploadFolderMenuItem()
     {
         return;
     }
-    ae_globals::get_Driver()->getFileHandler()->getRecursiveOp()->enactRecursiveUpload(targetNode, uploadNamePopup.getInputText());
+    if (uploadScanner != nullptr)
+    {
+        ae_globals::displayPopup("A folder is already being checked for upload. Please wait for it to finish.");
+        return;
+    }
+    if (!ae_globals::isValidLocalFolder(uploadNamePopup.getInputText()))
+    {
+        ae_globals::displayPopup(QString("Unable to read local folder: %1").arg(uploadNamePopup.getInputText()));
+        return;
+    }
+
+    //The folder is checked before anything is sent, so a bad name does not stop the upload part way through
+    uploadTarget = targetNode;
+    uploadScanner = new LocalTreeScanner(uploadNamePopup.getInputText(), this);
+    QObject::connect(uploadScanner, SIGNAL(scanFinished()), this, SLOT(uploadScanFinished()));
+    uploadScanner->startScan();
+}
+
+void ExplorerWindow::uploadScanFinished()
+{
+    const UploadManifest &theManifest = uploadScanner->getManifest();
+    QString localRoot = theManifest.localRoot;
+
+    if (!theManifest.rejectedNames.isEmpty() || !theManifest.unreadableFolders.isEmpty())
+    {
+        QStringList problemList = theManifest.unreadableFolders + theManifest.rejectedNames;
+        int problemCount = problemList.size();
+        while (problemList.size() > 10)
+        {
+            problemList.removeLast();
+        }
+
+        ae_globals::displayPopup(QString("Folder not uploaded. %1 entries have names which are not allowed, or cannot be read, including:\n%2")
+                                 .arg(problemCount).arg(problemList.join('\n')));
+    }
+    else if (uploadTarget.isNil() || ae_globals::get_Driver()->getFileHandler()->operationIsPending())
+    {
+        ae_globals::displayPopup("Folder not uploaded. The destination is no longer available, or another file operation is in progress.");
+    }
+    else
+    {
+        qCDebug(agaveAppLayer, "Uploading %s: %d files, %d folders, %lld bytes", qPrintable(localRoot),
+                theManifest.fileCount, theManifest.folderCount, theManifest.totalBytes);
+        ae_globals::get_Driver()->getFileHandler()->getRecursiveOp()->enactRecursiveUpload(uploadTarget, localRoot);
+        ae_globals::get_Driver()->getTransferJournal()->noteTransferStarted(TransferType::UPLOAD_FOLDER, uploadTarget.getFullPath(), localRoot);
+    }
+
+    uploadScanner->deleteLater();
+    uploadScanner = nullptr;
+}
+
+void ExplorerWindow::largeUploadProgress(qint64 bytesSent, qint64 bytesTotal)
+{
+    if ((largeUploadDialog == nullptr) || (bytesTotal <= 0)) return;
+    largeUploadDialog->setValue((int) ((bytesSent * 1000) / bytesTotal));
+}
+
+void ExplorerWindow::largeUploadFinished(bool succeeded, QString message)
+{
+    if (largeUploadDialog != nullptr)
+    {
+        largeUploadDialog->deleteLater();
+        largeUploadDialog = nullptr;
+    }
+    if (largeUpload != nullptr)
+    {
+        largeUpload->deleteLater();
+        largeUpload = nullptr;
+    }
+
+    ae_globals::displayPopup(message, succeeded ? "Upload Complete" : "Upload Failed");
+    if (succeeded) ae_globals::get_job_handle()->demandJobDataRefresh();
 }
 
 void ExplorerWindow::downloadFolderMenuItem()
@@ -323,7 +598,14 @@ void ExplorerWindow::downloadFolderMenuItem()
     {
         return;
     }
-    ae_globals::get_Driver()->getFileHandler()->getRecursiveOp()->enactRecursiveDownload(targetNode, downloadNamePopup.getInputText());
+    FileOperator * fileHandle = ae_globals::get_Driver()->getFileHandler();
+    if (fileHandle->operationIsPending())
+    {
+        ae_globals::displayPopup("Folder not downloaded. Another file operation is in progress.");
+        return;
+    }
+    fileHandle->getRecursiveOp()->enactRecursiveDownload(targetNode, downloadNamePopup.getInputText());
+    ae_globals::get_Driver()->getTransferJournal()->noteTransferStarted(TransferType::DOWNLOAD_FOLDER, targetNode.getFullPath(), downloadNamePopup.getInputText());
 }
 
 void ExplorerWindow::createFolderMenuItem()
@@ -345,19 +627,27 @@ void ExplorerWindow::downloadMenuItem()
     {
         return;
     }
-    ae_globals::get_Driver()->getFileHandler()->sendDownloadReq(targetNode, downloadNamePopup.getInputText());
+    FileOperator * fileHandle = ae_globals::get_Driver()->getFileHandler();
+    if (fileHandle->operationIsPending())
+    {
+        ae_globals::displayPopup("File not downloaded. Another file operation is in progress.");
+        return;
+    }
+    fileHandle->sendDownloadReq(targetNode, downloadNamePopup.getInputText());
+    ae_globals::get_Driver()->getTransferJournal()->noteTransferStarted(TransferType::DOWNLOAD_FILE, targetNode.getFullPath(), downloadNamePopup.getInputText());
 }
 
 void ExplorerWindow::readMenuItem()
 {
     QMessageBox dataPopup;
-    dataPopup.setText(QString(*(targetNode.getFileBuffer())));
+    dataPopup.setText(QString(ae_globals::get_Driver()->getBufferCache()->getBuffer(RemotePath(targetNode.getFullPath()))));
     dataPopup.exec();
 }
 
 void ExplorerWindow::retriveMenuItem()
 {
     ae_globals::get_Driver()->getFileHandler()->sendDownloadBuffReq(targetNode);
+    ae_globals::get_Driver()->getBufferCache()->adoptWhenLoaded(targetNode);
 }
 
 void ExplorerWindow::refreshMenuItem()
@@ -390,13 +680,21 @@ void ExplorerWindow::jobRightClickMenu(QPoint pos)
     jobMenu.addAction("Refresh Job Info", this, SLOT(demandJobRefresh()));
 
     QModelIndex targetIndex = ui->jobTable->indexAt(pos);
-    ui->jobTable->jobEntryTouched(targetIndex);
+    if (targetIndex.isValid())
+    {
+        ui->jobTable->selectRow(targetIndex.row());
+    }
 
-    targetJob = ui->jobTable->getSelectedJob();
+    targetJob = jobModel->getJobAtRow(targetIndex.row());
 
     if (targetJob.isValidEntry())
     {
         jobMenu.addAction("Delete This Job Entry", this, SLOT(deleteJobDataEntry()));
+        if (targetJob.getState() == "RUNNING")
+        {
+            jobMenu.addAction("Tail Output", this, SLOT(tailJobOutput()));
+        }
+        jobMenu.addAction("Set Output Harvest Rule For This App . . .", this, SLOT(setHarvestRule()));
     }
 
     jobMenu.exec(QCursor::pos());
@@ -408,6 +706,56 @@ void ExplorerWindow::demandJobRefresh()
     ae_globals::get_job_handle()->demandJobDataRefresh();
 }
 
+void ExplorerWindow::tailJobOutput()
+{
+    if (!targetJob.isValidEntry()) return;
+
+    //Agave names the job log after the job, unless the app says otherwise
+    SingleLineDialog logNamePopup("Please input the log file to follow, relative to the job output:", QString("%1-%2.out").arg(targetJob.getName(), targetJob.getID()));
+    if (logNamePopup.exec() != QDialog::Accepted)
+    {
+        return;
+    }
+
+    JobTailDialog * tailWindow = new JobTailDialog(targetJob.getID(), logNamePopup.getInputText());
+    tailWindow->show();
+}
+
+void ExplorerWindow::setHarvestRule()
+{
+    if (!targetJob.isValidEntry()) return;
+
+    //The rule is kept for the app without its version, such as cwe-serial
+    QString appName = targetJob.getApp().section('-', 0, -2);
+    QString currentRule = outputHarvester->getHarvestRule(appName);
+    if (currentRule.isEmpty())
+    {
+        currentRule = "output/*.csv -> ~/runs/<jobId>";
+    }
+
+    SingleLineDialog rulePopup(QString("Outputs to fetch when a %1 job finishes (leave empty for none):").arg(appName), currentRule);
+    if (rulePopup.exec() != QDialog::Accepted)
+    {
+        return;
+    }
+    outputHarvester->setHarvestRule(appName, rulePopup.getInputText());
+}
+
+void ExplorerWindow::jobStateChanged(RemoteJobData changedJob)
+{
+    if (changedJob.getState() == "FINISHED")
+    {
+        outputHarvester->jobFinished(changedJob);
+    }
+}
+
+void ExplorerWindow::jobListUpdated()
+{
+    //Keep the target job pointing at the current data for the same job
+    if (!targetJob.isValidEntry()) return;
+    targetJob = jobModel->getJobWithID(targetJob.getID());
+}
+
 void ExplorerWindow::deleteJobDataEntry()
 {
     if (ae_globals::get_job_handle()->currentlyPerformingJobOperation()) return;
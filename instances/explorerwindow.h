@@ -49,10 +49,18 @@ class RemoteFileTree;
 class FileMetaData;
 class FileTreeNode;
 class FileOperator;
+class FolderPrefetcher;
+class JobListModel;
+class JobOutputHarvester;
+class BulkFileOperation;
+class LocalTreeScanner;
+class MultipartUploader;
+class QProgressDialog;
 
 class ExplorerDriver;
 class RemoteDataInterface;
 enum class RequestState;
+enum class BulkOpType;
 
 namespace Ui {
 class ExplorerWindow;
@@ -71,6 +79,10 @@ public:
     void addAppToList(QString appName);
 
 private slots:
+    void panelTabChanged(int newIndex);
+    void buildAppPanel();
+    void buildJobPanel();
+
     void agaveAppSelected(QModelIndex clickedItem);
 
     void agaveCommandInvoked();
@@ -83,8 +95,16 @@ private slots:
     void renameMenuItem();
     void deleteMenuItem();
 
+    void bulkCopyMenuItem();
+    void bulkMoveMenuItem();
+    void bulkDeleteMenuItem();
+    void bulkOperationDone(int succeeded, int failed);
+
     void uploadMenuItem();
     void uploadFolderMenuItem();
+    void uploadScanFinished();
+    void largeUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void largeUploadFinished(bool succeeded, QString message);
     void downloadFolderMenuItem();
 
     void createFolderMenuItem();
@@ -97,19 +117,40 @@ private slots:
 
     void demandJobRefresh();
     void deleteJobDataEntry();
+    void tailJobOutput();
+    void setHarvestRule();
+    void jobStateChanged(RemoteJobData changedJob);
+    void jobListUpdated();
 
 private:
+    bool bulkMenuNeeded(QModelIndex clickedIndex);
+    void startBulkOperation(BulkOpType opType, QString destFolder);
+
     Ui::ExplorerWindow *ui;
 
     FileNodeRef targetNode;
     RemoteJobData targetJob;
+    QStringList bulkTargets;
 
     QStandardItemModel taskListModel;
     QString selectedAgaveApp;
 
     QMap<QString, QStringList> agaveParamLists;
 
+    FolderPrefetcher * folderPrefetcher = nullptr;
+    JobListModel * jobModel = nullptr;
+    JobOutputHarvester * outputHarvester = nullptr;
+    BulkFileOperation * bulkOperation = nullptr;
+    LocalTreeScanner * uploadScanner = nullptr;
+    FileNodeRef uploadTarget;
+    MultipartUploader * largeUpload = nullptr;
+    QProgressDialog * largeUploadDialog = nullptr;
+
     bool waitingOnCommand = false;
+    bool appPanelBuilt = false;
+    bool jobPanelBuilt = false;
+
+    static const int JOB_PANEL_DEFER_MS = 2000;
 };
 
 #endif // EXPLORERWINDOW_H
@@ -0,0 +1,245 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "headlessrunner.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSslSocket>
+#include <QTextStream>
+
+#include "utilFuncs/agavesession.h"
+#include "utilFuncs/batchengine.h"
+#include "remotedatainterface.h"
+#include "remoteFiles/fileoperator.h"
+#include "remoteJobs/joboperator.h"
+
+#include "ae_globals.h"
+
+HeadlessRunner::HeadlessRunner(int argc, char *argv[], QObject *parent) : QObject(parent)
+{
+    for (int i = 0; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i],"headlessSessions") == 0)
+        {
+            accountsFileName = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"networkThreads") == 0)
+        {
+            networkThreadCount = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"batchScript") == 0)
+        {
+            batchScriptName = QString(argv[i+1]);
+        }
+        if (strcmp(argv[i],"batchWaitMinutes") == 0)
+        {
+            batchWaitMinutes = QString(argv[i+1]).toDouble();
+        }
+    }
+
+    QObject::connect(&workTimer, SIGNAL(timeout()), this, SLOT(checkSessionWork()));
+    runTimer.start();
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+    if (sessionPool != nullptr) delete sessionPool;
+}
+
+void HeadlessRunner::startup()
+{
+    QTextStream reportStream(stdout);
+
+    if (!QSslSocket::supportsSsl())
+    {
+        reportStream << "SSL support was not detected on this computer." << endl;
+        finishRun(-1);
+        return;
+    }
+
+    QFile accountsFile(accountsFileName);
+    if (!accountsFile.open(QIODevice::ReadOnly))
+    {
+        reportStream << "Unable to open accounts file: " << accountsFileName << endl;
+        finishRun(-1);
+        return;
+    }
+    QJsonArray accountList = QJsonDocument::fromJson(accountsFile.readAll()).array();
+    accountsFile.close();
+
+    sessionPool = new AgaveSessionPool(networkThreadCount);
+    runTimer.restart();
+
+    for (QJsonValue anAccount : accountList)
+    {
+        QJsonObject accountObject = anAccount.toObject();
+        QString username = accountObject.value("username").toString();
+        if (username.isEmpty()) continue;
+
+        AgaveSession * newSession = sessionPool->createSession(accountObject.value("name").toString(username));
+        if (accountObject.contains("host"))
+        {
+            newSession->setConnectionParams(accountObject.value("host").toString(),
+                                            accountObject.value("client").toString("SimCenter_CWE_GUI"),
+                                            accountObject.value("storage").toString("designsafe.storage.default"));
+        }
+
+        RemoteDataReply * authReply = newSession->performAuth(username, accountObject.value("password").toString());
+        if (authReply == nullptr)
+        {
+            reportStream << newSession->getName() << ": unable to start authentication" << endl;
+            continue;
+        }
+        pendingAuths.insert(authReply, newSession);
+        QObject::connect(authReply, SIGNAL(haveAuthReply(RequestState)), this, SLOT(getAuthReply(RequestState)));
+    }
+
+    if (pendingAuths.isEmpty())
+    {
+        reportStream << "No accounts to run." << endl;
+        finishRun(-1);
+    }
+}
+
+void HeadlessRunner::getAuthReply(RequestState authReply)
+{
+    AgaveSession * theSession = pendingAuths.take(sender());
+    if (theSession == nullptr) return;
+
+    if (authReply == RequestState::GOOD)
+    {
+        readySessions.append(theSession);
+    }
+    else
+    {
+        QTextStream(stdout) << theSession->getName() << ": authentication failed" << endl;
+    }
+
+    if (!pendingAuths.isEmpty()) return;
+
+    if (readySessions.isEmpty())
+    {
+        finishRun(-1);
+        return;
+    }
+    startSessionWork();
+}
+
+void HeadlessRunner::startSessionWork()
+{
+    QTextStream(stdout) << readySessions.size() << " sessions authenticated in " << runTimer.elapsed() << " ms" << endl;
+
+    if (!batchScriptName.isEmpty())
+    {
+        startBatchWork();
+        return;
+    }
+
+    for (AgaveSession * aSession : readySessions)
+    {
+        aSession->getFileHandler()->enactRootRefresh();
+        aSession->getJobHandler()->demandJobDataRefresh();
+    }
+    workTimer.start(250);
+}
+
+void HeadlessRunner::checkSessionWork()
+{
+    for (AgaveSession * aSession : readySessions)
+    {
+        if (aSession->getFileHandler()->operationIsPending()) return;
+        if (aSession->getJobHandler()->currentlyRefreshingJobs()) return;
+    }
+    workTimer.stop();
+    finishRun(0);
+}
+
+void HeadlessRunner::startBatchWork()
+{
+    for (AgaveSession * aSession : readySessions)
+    {
+        BatchEngine * newBatch = new BatchEngine(aSession, 8, this);
+        newBatch->setWaitTimeout((qint64) (batchWaitMinutes * 60 * 1000));
+        QString errorText;
+        if (!newBatch->loadScript(batchScriptName, &errorText))
+        {
+            QTextStream(stdout) << errorText << endl;
+            delete newBatch;
+            finishRun(-1);
+            return;
+        }
+        runningBatches.insert(newBatch, aSession);
+        QObject::connect(newBatch, SIGNAL(batchFinished(bool)), this, SLOT(batchDone()));
+    }
+
+    for (BatchEngine * aBatch : runningBatches.keys())
+    {
+        aBatch->start();
+    }
+}
+
+void HeadlessRunner::batchDone()
+{
+    BatchEngine * theBatch = qobject_cast<BatchEngine *>(sender());
+    if (!runningBatches.contains(theBatch)) return;
+
+    AgaveSession * theSession = runningBatches.take(theBatch);
+    QTextStream(stdout) << theSession->getName() << " batch:" << endl << theBatch->getReport() << endl;
+    batchFailures += theBatch->getFailedCount();
+    theBatch->deleteLater();
+
+    if (!runningBatches.isEmpty()) return;
+    finishRun((batchFailures == 0) ? 0 : 1);
+}
+
+void HeadlessRunner::finishRun(int exitCode)
+{
+    QTextStream reportStream(stdout);
+    if (sessionPool != nullptr)
+    {
+        for (AgaveSession * aSession : sessionPool->getSessions())
+        {
+            reportStream << aSession->getThroughputReport() << endl;
+        }
+    }
+    reportStream << "Total run time: " << runTimer.elapsed() << " ms" << endl;
+
+    //Deferred, since this may be called before the event loop is running
+    QTimer::singleShot(0, [exitCode]() { QCoreApplication::exit(exitCode); });
+}
@@ -0,0 +1,92 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QMap>
+#include <QElapsedTimer>
+
+class AgaveSessionPool;
+class AgaveSession;
+class BatchEngine;
+enum class RequestState;
+
+/*! \brief The HeadlessRunner drives many AgaveSessions in one process, without any windows.
+ *
+ *  The runner is started by giving main() the arguments: headlessSessions <accountsFile> [networkThreads <n>] [batchScript <scriptFile> [batchWaitMinutes <n>]]
+ *
+ *  The accounts file is a JSON array of objects, each with "username" and "password", and optionally "name", "host", "client" and "storage" to select the Agave tenant.
+ *  Every account is authenticated in its own session. Each session then lists its files and jobs, or, if a batch script is given, runs that script with a BatchEngine. The throughput of every session is reported before the program exits.
+ */
+
+class HeadlessRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessRunner(int argc, char *argv[], QObject *parent = nullptr);
+    ~HeadlessRunner();
+
+    void startup();
+
+private slots:
+    void getAuthReply(RequestState authReply);
+    void checkSessionWork();
+    void batchDone();
+
+private:
+    void startSessionWork();
+    void startBatchWork();
+    void finishRun(int exitCode);
+
+    QString accountsFileName;
+    int networkThreadCount = 2;
+    QString batchScriptName;
+    double batchWaitMinutes = 0;
+
+    AgaveSessionPool * sessionPool = nullptr;
+    QMap<QObject *, AgaveSession *> pendingAuths;
+    QList<AgaveSession *> readySessions;
+    QMap<BatchEngine *, AgaveSession *> runningBatches;
+    int batchFailures = 0;
+
+    QTimer workTimer;
+    QElapsedTimer runTimer;
+};
+
+#endif // HEADLESSRUNNER_H
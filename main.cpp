@@ -38,11 +38,25 @@
 #include <QSslSocket>
 
 #include "instances/explorerdriver.h"
+#include "instances/headlessrunner.h"
 #include "remotedatainterface.h"
 #include "ae_globals.h"
 
 int main(int argc, char *argv[])
 {
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i],"headlessSessions") == 0)
+        {
+            QCoreApplication headlessRunLoop(argc, argv);
+
+            HeadlessRunner sessionRunner(argc, argv, nullptr);
+            sessionRunner.startup();
+
+            return headlessRunLoop.exec();
+        }
+    }
+
     QApplication mainRunLoop(argc, argv);
 
     ExplorerDriver programDriver(argc, argv, nullptr);
@@ -0,0 +1,176 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agavesession.h"
+
+#include "utilFuncs/trafficnetmanager.h"
+#include "utilFuncs/servicerequest.h"
+#include "remoteFiles/fileoperator.h"
+#include "remoteJobs/joboperator.h"
+
+#include "agaveInterfaces/agavehandler.h"
+
+AgaveSession::AgaveSession(QString sessionName, QThread * networkThread, QObject *parent) : QObject(parent)
+{
+    myName = sessionName;
+
+    myNetManager = new TrafficNetManager(TrafficMode::PASSTHROUGH, QString());
+    myNetManager->moveToThread(networkThread);
+
+    myDataInterface = new AgaveHandler(myNetManager);
+    myDataInterface->moveToThread(networkThread);
+    setConnectionParams("https://agave.designsafe-ci.org", "SimCenter_CWE_GUI", "designsafe.storage.default");
+
+    myJobHandle = new JobOperator(myDataInterface, this);
+    myFileHandle = new FileOperator(myDataInterface, this);
+
+    sessionTimer.start();
+}
+
+AgaveSession::~AgaveSession()
+{
+    //The handler and network manager live in a shared network thread
+    myDataInterface->deleteLater();
+    myNetManager->deleteLater();
+}
+
+void AgaveSession::registerInterfaceTypes()
+{
+    qRegisterMetaType<RequestState>("RequestState");
+    qRegisterMetaType<FileNodeRef>("FileNodeRef");
+    qRegisterMetaType<FileMetaData>("FileMetaData");
+    qRegisterMetaType<RemoteJobData>("RemoteJobData");
+    qRegisterMetaType<RemoteDataInterfaceState>("RemoteDataInterfaceState");
+    qRegisterMetaType<QList<FileMetaData>>("QList<FileMetaData>");
+    qRegisterMetaType<QList<RemoteJobData>>("QList<RemoteJobData>");
+}
+
+void AgaveSession::setConnectionParams(QString host, QString clientName, QString storage)
+{
+    myDataInterface->setAgaveConnectionParams(host, clientName, storage);
+    myNetManager->setServiceBase(host);
+}
+
+RemoteDataReply * AgaveSession::performAuth(QString username, QString password)
+{
+    sessionTimer.restart();
+    return myDataInterface->performAuth(username, password);
+}
+
+QString AgaveSession::getName()
+{
+    return myName;
+}
+
+RemoteDataInterface * AgaveSession::getDataConnection()
+{
+    return myDataInterface;
+}
+
+JobOperator * AgaveSession::getJobHandler()
+{
+    return myJobHandle;
+}
+
+FileOperator * AgaveSession::getFileHandler()
+{
+    return myFileHandle;
+}
+
+TrafficNetManager * AgaveSession::getNetManager()
+{
+    return myNetManager;
+}
+
+ServiceRequest * AgaveSession::readJobOutput(QString jobID, QString outputPath, qint64 fromOffset)
+{
+    return ServiceRequest::jobOutputRead(myNetManager, jobID, outputPath, fromOffset);
+}
+
+QString AgaveSession::getThroughputReport()
+{
+    double elapsedSec = sessionTimer.elapsed() / 1000.0;
+    int requestCount = myNetManager->getRequestCount();
+    qint64 bytesReceived = myNetManager->getBytesReceived();
+
+    double requestRate = 0;
+    double byteRate = 0;
+    if (elapsedSec > 0)
+    {
+        requestRate = requestCount / elapsedSec;
+        byteRate = (bytesReceived / 1024.0) / elapsedSec;
+    }
+
+    return QString("%1: %2 requests, %3 bytes in %4 s (%5 req/s, %6 KB/s)")
+            .arg(myName).arg(requestCount).arg(bytesReceived)
+            .arg(elapsedSec, 0, 'f', 1).arg(requestRate, 0, 'f', 2).arg(byteRate, 0, 'f', 1);
+}
+
+AgaveSessionPool::AgaveSessionPool(int threadCount, QObject *parent) : QObject(parent)
+{
+    AgaveSession::registerInterfaceTypes();
+
+    for (int i = 0; i < qMax(1, threadCount); i++)
+    {
+        QThread * newThread = new QThread(this);
+        newThread->start();
+        networkThreads.append(newThread);
+    }
+}
+
+AgaveSessionPool::~AgaveSessionPool()
+{
+    qDeleteAll(sessionList);
+    sessionList.clear();
+
+    for (QThread * aThread : networkThreads)
+    {
+        aThread->quit();
+        aThread->wait();
+    }
+}
+
+AgaveSession * AgaveSessionPool::createSession(QString sessionName)
+{
+    QThread * sessionThread = networkThreads.at(sessionList.size() % networkThreads.size());
+    AgaveSession * newSession = new AgaveSession(sessionName, sessionThread);
+    sessionList.append(newSession);
+    return newSession;
+}
+
+QList<AgaveSession *> AgaveSessionPool::getSessions()
+{
+    return sessionList;
+}
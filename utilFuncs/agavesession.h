@@ -0,0 +1,110 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVESESSION_H
+#define AGAVESESSION_H
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+#include <QElapsedTimer>
+
+class RemoteDataInterface;
+class RemoteDataReply;
+class AgaveHandler;
+class JobOperator;
+class FileOperator;
+class TrafficNetManager;
+class ServiceRequest;
+
+/*! \brief An AgaveSession is one independent connection to Agave, with its own credentials, handler and operators.
+ *
+ *  Unlike the AgaveSetupDriver, which is the single driver of an interactive program, any number of sessions can exist in one process.
+ *  Sessions do not use ae_globals. Each session has its own network manager, so that credentials are never shared, but the network threads are shared through an AgaveSessionPool.
+ */
+
+class AgaveSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AgaveSession(QString sessionName, QThread * networkThread, QObject *parent = nullptr);
+    ~AgaveSession();
+
+    static void registerInterfaceTypes();
+
+    void setConnectionParams(QString host, QString clientName, QString storage);
+    RemoteDataReply * performAuth(QString username, QString password);
+
+    QString getName();
+    RemoteDataInterface * getDataConnection();
+    JobOperator * getJobHandler();
+    FileOperator * getFileHandler();
+    TrafficNetManager * getNetManager();
+    ServiceRequest * readJobOutput(QString jobID, QString outputPath, qint64 fromOffset = 0);
+
+    QString getThroughputReport();
+
+private:
+    QString myName;
+
+    TrafficNetManager * myNetManager = nullptr;
+    AgaveHandler * myDataInterface = nullptr;
+    JobOperator * myJobHandle = nullptr;
+    FileOperator * myFileHandle = nullptr;
+
+    QElapsedTimer sessionTimer;
+};
+
+/*! \brief The AgaveSessionPool creates AgaveSessions, spreading them over a fixed set of shared network threads.
+ */
+
+class AgaveSessionPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AgaveSessionPool(int threadCount, QObject *parent = nullptr);
+    ~AgaveSessionPool();
+
+    AgaveSession * createSession(QString sessionName);
+    QList<AgaveSession *> getSessions();
+
+private:
+    QList<QThread *> networkThreads;
+    QList<AgaveSession *> sessionList;
+};
+
+#endif // AGAVESESSION_H
@@ -37,26 +37,33 @@
 
 #include "ae_globals.h"
 #include "utilFuncs/authform.h"
+#include "utilFuncs/agavesession.h"
+#include "utilFuncs/trafficnetmanager.h"
+#include "utilFuncs/servicerequest.h"
+#include "utilFuncs/transferjournal.h"
+#include "utilFuncs/filebuffercache.h"
+#include "utilFuncs/diskwriterpool.h"
+#include "utilFuncs/stallwatchdog.h"
+#include "utilFuncs/jobnotificationlistener.h"
 #include "remoteFiles/fileoperator.h"
 #include "remoteJobs/joboperator.h"
 
 #include "agaveInterfaces/agavehandler.h"
 
+#include <QDir>
+#include <QTimer>
+#include <QStandardPaths>
+
 Q_LOGGING_CATEGORY(agaveAppLayer, "Agave App Layer")
 
 QStringList AgaveSetupDriver::enabledDebugs;
 
 AgaveSetupDriver::AgaveSetupDriver(int argc, char *argv[], QObject *parent) : QObject(parent)
 {
+    startupClock.start();
     ae_globals::set_Driver(this);
 
-    qRegisterMetaType<RequestState>("RequestState");
-    qRegisterMetaType<FileNodeRef>("FileNodeRef");
-    qRegisterMetaType<FileMetaData>("FileMetaData");
-    qRegisterMetaType<RemoteJobData>("RemoteJobData");
-    qRegisterMetaType<RemoteDataInterfaceState>("RemoteDataInterfaceState");
-    qRegisterMetaType<QList<FileMetaData>>("QList<FileMetaData>");
-    qRegisterMetaType<QList<RemoteJobData>>("QList<RemoteJobData>");
+    AgaveSession::registerInterfaceTypes();
 
     qApp->setQuitOnLastWindowClosed(false);
     //Note: Window closing must link to the shutdown sequence, otherwise the app will not close
@@ -64,8 +71,26 @@ AgaveSetupDriver::AgaveSetupDriver(int argc, char *argv[], QObject *parent) : QO
 
     debugLoggingEnabled = false;
     offlineMode = false;
+    trafficMode = TrafficMode::PASSTHROUGH;
     for (int i = 0; i < argc; i++)
     {
+        //Traffic replay needs no network, so it always runs in offline mode
+        if ((strcmp(argv[i],"recordTraffic") == 0) && (i + 1 < argc))
+        {
+            trafficMode = TrafficMode::RECORD;
+            trafficFileName = QString(argv[i+1]);
+        }
+        if ((strcmp(argv[i],"replayTraffic") == 0) && (i + 1 < argc))
+        {
+            trafficMode = TrafficMode::REPLAY;
+            trafficFileName = QString(argv[i+1]);
+            offlineMode = true;
+            debugLoggingEnabled = true;
+        }
+        if ((strcmp(argv[i],"replaySpeed") == 0) && (i + 1 < argc))
+        {
+            replaySpeed = QString(argv[i+1]).toDouble();
+        }
         if ((strcmp(argv[i],"enableDebugLogging") == 0) || (strcmp(argv[i],"offlineMode") == 0))
         {
             debugLoggingEnabled = true;
@@ -74,6 +99,58 @@ AgaveSetupDriver::AgaveSetupDriver(int argc, char *argv[], QObject *parent) : QO
         {
             offlineMode = true;
         }
+        if (strcmp(argv[i],"enablePrefetch") == 0)
+        {
+            prefetchEnabled = true;
+        }
+        if ((strcmp(argv[i],"shutdownDeadline") == 0) && (i + 1 < argc))
+        {
+            shutdownDeadline = QString(argv[i+1]).toInt();
+        }
+        if ((strcmp(argv[i],"bufferCacheMB") == 0) && (i + 1 < argc))
+        {
+            bufferCacheMB = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"spillFileBuffers") == 0)
+        {
+            spillFileBuffers = true;
+        }
+        if ((strcmp(argv[i],"notificationPort") == 0) && (i + 1 < argc))
+        {
+            notificationPort = QString(argv[i+1]).toInt();
+        }
+        if ((strcmp(argv[i],"notificationHost") == 0) && (i + 1 < argc))
+        {
+            notificationHost = QString(argv[i+1]);
+        }
+        if ((strcmp(argv[i],"notificationBind") == 0) && (i + 1 < argc))
+        {
+            notificationBind = QString(argv[i+1]);
+        }
+        if ((strcmp(argv[i],"assemblyApp") == 0) && (i + 1 < argc))
+        {
+            assemblyAppID = QString(argv[i+1]);
+        }
+        if ((strcmp(argv[i],"uploadPartMB") == 0) && (i + 1 < argc))
+        {
+            uploadPartMB = QString(argv[i+1]).toInt();
+        }
+        if ((strcmp(argv[i],"stallThresholdMs") == 0) && (i + 1 < argc))
+        {
+            stallThresholdMs = QString(argv[i+1]).toInt();
+        }
+        if ((strcmp(argv[i],"httpCacheMB") == 0) && (i + 1 < argc))
+        {
+            httpCacheMB = QString(argv[i+1]).toInt();
+        }
+        if ((strcmp(argv[i],"warmConnections") == 0) && (i + 1 < argc))
+        {
+            warmConnections = QString(argv[i+1]).toInt();
+        }
+        if (strcmp(argv[i],"fastStartup") == 0)
+        {
+            fastStartup = true;
+        }
     }
     if (offlineMode)
     {
@@ -107,17 +184,63 @@ void AgaveSetupDriver::createAndStartAgaveThread()
 
     remoteInterfacesThread->start();
 
-    theNetManager = new QNetworkAccessManager();
+    theNetManager = new TrafficNetManager(trafficMode, trafficFileName, replaySpeed);
+    theNetManager->enableResponseCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/httpCache",
+                                       ((qint64) httpCacheMB) * 1024 * 1024);
     theNetManager->moveToThread(remoteInterfacesThread);
 
     myDataInterface = new AgaveHandler(theNetManager);
     myDataInterface->moveToThread(remoteInterfacesThread);
-    myDataInterface->setAgaveConnectionParams("https://agave.designsafe-ci.org", "SimCenter_CWE_GUI", "designsafe.storage.default");
+    QString agaveServiceBase = "https://agave.designsafe-ci.org";
+    myDataInterface->setAgaveConnectionParams(agaveServiceBase, "SimCenter_CWE_GUI", storageSystem);
+    theNetManager->setServiceBase(agaveServiceBase);
     QObject::connect(myDataInterface, SIGNAL(connectionStateChanged(RemoteDataInterfaceState)),
                      this, SLOT(newConnectionState(RemoteDataInterfaceState)));
 
     myJobHandle = new JobOperator(myDataInterface, this);
     myFileHandle = new FileOperator(myDataInterface, this);
+
+    QString journalFolder = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(journalFolder);
+    myTransferJournal = new TransferJournal(journalFolder + "/transferJournal.json", myFileHandle, this);
+
+    //Connections are opened while the user is still logging in, so the first request does not wait on the handshake
+    if (!offlineMode && (warmConnections > 0))
+    {
+        QMetaObject::invokeMethod(theNetManager, "prewarmConnections", Qt::QueuedConnection,
+                                  Q_ARG(QString, agaveServiceBase), Q_ARG(int, warmConnections),
+                                  Q_ARG(QString, journalFolder + "/tlsSession.dat"));
+    }
+
+    QString spillFolder;
+    if (spillFileBuffers)
+    {
+        spillFolder = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/fileBuffers";
+    }
+    myBufferCache = new FileBufferCache(((qint64) bufferCacheMB) * 1024 * 1024, myFileHandle, spillFolder, this);
+    myDiskWriter = new DiskWriterPool(2, 64 * 1024 * 1024, this);
+
+    //Large uploads are sent in parts, which need an app to join them on the remote side
+    if (!assemblyAppID.isEmpty())
+    {
+        myDataInterface->registerAgaveAppInfo("assemble-parts", assemblyAppID, {"directory", "parts", "checksums", "output"}, {}, "directory");
+    }
+
+    //Job status polling remains in place, notifications only make updates arrive sooner
+    if (notificationPort > 0)
+    {
+        if (notificationHost.isEmpty())
+        {
+            notificationHost = "localhost";
+        }
+        myNotificationListener = new JobNotificationListener(notificationHost, notificationBind, notificationPort, this);
+        QObject::connect(myNotificationListener, SIGNAL(jobStatusReceived(QString,QString)),
+                         this, SLOT(jobStatusNotified(QString,QString)));
+
+        notificationRefreshTimer.setSingleShot(true);
+        notificationRefreshTimer.setInterval(500);
+        QObject::connect(&notificationRefreshTimer, SIGNAL(timeout()), this, SLOT(notifiedJobRefresh()));
+    }
 }
 
 void AgaveSetupDriver::setDebugLogging(bool loggingEnabled)
@@ -154,6 +277,36 @@ bool AgaveSetupDriver::sslCheckOkay()
     #endif
 }
 
+bool AgaveSetupDriver::prefetchIsEnabled()
+{
+    return prefetchEnabled;
+}
+
+bool AgaveSetupDriver::fastStartupEnabled()
+{
+    return fastStartup;
+}
+
+void AgaveSetupDriver::markStartupPoint(QString pointName)
+{
+    qCDebug(agaveAppLayer, "Startup: %s at %lld ms%s", qPrintable(pointName), startupClock.elapsed(), fastStartup ? " (fast startup)" : "");
+}
+
+QString AgaveSetupDriver::getStorageSystem()
+{
+    return storageSystem;
+}
+
+QString AgaveSetupDriver::getAssemblyApp()
+{
+    return assemblyAppID;
+}
+
+qint64 AgaveSetupDriver::getUploadPartSize()
+{
+    return ((qint64) qMax(1, uploadPartMB)) * 1024 * 1024;
+}
+
 RemoteDataInterface * AgaveSetupDriver::getDataConnection()
 {
     return myDataInterface;
@@ -169,6 +322,47 @@ FileOperator * AgaveSetupDriver::getFileHandler()
     return myFileHandle;
 }
 
+TransferJournal * AgaveSetupDriver::getTransferJournal()
+{
+    return myTransferJournal;
+}
+
+FileBufferCache * AgaveSetupDriver::getBufferCache()
+{
+    return myBufferCache;
+}
+
+void AgaveSetupDriver::startStallWatchdog()
+{
+    //A threshold of 0 turns the watchdog off
+    if ((stallThresholdMs <= 0) || (myStallWatchdog != nullptr)) return;
+
+    QString logFolder = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(logFolder);
+    myStallWatchdog = new StallWatchdog(logFolder + "/stallLog.txt", stallThresholdMs, this);
+    myStallWatchdog->start();
+}
+
+DiskWriterPool * AgaveSetupDriver::getDiskWriter()
+{
+    return myDiskWriter;
+}
+
+TrafficNetManager * AgaveSetupDriver::getNetManager()
+{
+    return theNetManager;
+}
+
+ServiceRequest * AgaveSetupDriver::readJobOutput(QString jobID, QString outputPath, qint64 fromOffset)
+{
+    return ServiceRequest::jobOutputRead(theNetManager, jobID, outputPath, fromOffset);
+}
+
+JobNotificationListener * AgaveSetupDriver::getNotificationListener()
+{
+    return myNotificationListener;
+}
+
 void AgaveSetupDriver::getAuthReply(RequestState authReply)
 {
     if ((authReply == RequestState::GOOD) && (authWindow != nullptr) && (authWindow->isVisible()))
@@ -196,11 +390,31 @@ void AgaveSetupDriver::newConnectionState(RemoteDataInterfaceState newState)
     }
 }
 
+void AgaveSetupDriver::jobStatusNotified(QString, QString)
+{
+    //A burst of notifications results in a single refresh
+    notificationRefreshTimer.start();
+}
+
+void AgaveSetupDriver::notifiedJobRefresh()
+{
+    if (shutdownStarted || (myJobHandle == nullptr)) return;
+    if (myJobHandle->currentlyRefreshingJobs()) return;
+    myJobHandle->demandJobDataRefresh();
+}
+
 void AgaveSetupDriver::shutdown()
 {
     if (shutdownStarted) return;
     shutdownStarted = true;
 
+    //Transfers aborted below must not set off the next queued resume
+    if (myTransferJournal != nullptr)
+    {
+        myTransferJournal->holdResumes();
+        myTransferJournal->writeCheckpoint();
+    }
+
     if ((myDataInterface == nullptr) || (myDataInterface->getInterfaceState() == RemoteDataInterfaceState::INIT) ||
             (myDataInterface->getInterfaceState() == RemoteDataInterfaceState::READY_TO_AUTH) ||
             (myDataInterface->getInterfaceState() == RemoteDataInterfaceState::DISCONNECTED))
@@ -210,12 +424,28 @@ void AgaveSetupDriver::shutdown()
     }
 
     qCDebug(agaveAppLayer, "Beginning graceful shutdown.");
+    if (theNetManager != nullptr)
+    {
+        qCDebug(agaveAppLayer, "Read requests coalesced: %d of %d", theNetManager->getCoalescedReadCount(), theNetManager->getReadRequestCount());
+        qCDebug(agaveAppLayer, "Cached reads: %d hits of %d, %d with no request", theNetManager->getCacheHitCount(),
+                theNetManager->getCacheableReadCount(), theNetManager->getCacheOnlyCount());
+        int handshakes = theNetManager->getHandshakeCount();
+        if (handshakes > 0)
+        {
+            qCDebug(agaveAppLayer, "TLS handshakes: %d, average %lld ms, %d offering a saved session", handshakes,
+                    theNetManager->getHandshakeTotalTime() / handshakes, theNetManager->getResumeOfferCount());
+        }
+    }
+    //Transfers are already in the journal, so they can be dropped rather than waited on
+    QMetaObject::invokeMethod(theNetManager, "abortBulkTransfers", Qt::QueuedConnection);
     RemoteDataReply * shutdownInvoke = myDataInterface->closeAllConnections();
     shutdownInvoke->setAsUnconnectedReply();
 
     qCDebug(agaveAppLayer, "Waiting on outstanding tasks");
+    QTimer::singleShot(shutdownDeadline * 1000, this, SLOT(shutdownCallback()));
+
     QMessageBox * waitBox = new QMessageBox(); //Note: deliberate memory leak, as program closes right after
-    waitBox->setText("Waiting for network shutdown. Click Close to force quit.");
+    waitBox->setText(QString("Waiting for network shutdown. The program will close within %1 seconds. Click Close to force quit.").arg(shutdownDeadline));
     waitBox->setStandardButtons(QMessageBox::Close);
     waitBox->setDefaultButton(QMessageBox::Close);
     QObject::connect(waitBox, SIGNAL(buttonClicked(QAbstractButton*)), this, SLOT(shutdownCallback()));
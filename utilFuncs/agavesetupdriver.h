@@ -39,16 +39,26 @@
 #include <QObject>
 #include <QApplication>
 #include <QNetworkAccessManager>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <QTimer>
 
 enum class RequestState;
 enum class RemoteDataInterfaceState;
+enum class TrafficMode;
 
 class RemoteDataInterface;
 class AgaveHandler;
 class AuthForm;
 class JobOperator;
 class FileOperator;
+class TrafficNetManager;
+class TransferJournal;
+class FileBufferCache;
+class DiskWriterPool;
+class StallWatchdog;
+class JobNotificationListener;
+class ServiceRequest;
 
 class AgaveSetupDriver : public QObject
 {
@@ -58,6 +68,7 @@ public:
     ~AgaveSetupDriver();
     virtual void startup() = 0;
     void createAndStartAgaveThread();
+    void startStallWatchdog();
 
     virtual void closeAuthScreen() = 0;
 
@@ -66,6 +77,12 @@ public:
     RemoteDataInterface *getDataConnection();
     JobOperator * getJobHandler();
     FileOperator * getFileHandler();
+    TransferJournal * getTransferJournal();
+    FileBufferCache * getBufferCache();
+    DiskWriterPool * getDiskWriter();
+    TrafficNetManager * getNetManager();
+    ServiceRequest * readJobOutput(QString jobID, QString outputPath, qint64 fromOffset = 0);
+    JobNotificationListener * getNotificationListener();
 
     virtual QString getBanner() = 0;
     virtual QString getVersion() = 0;
@@ -75,17 +92,26 @@ public:
 
     static bool sslCheckOkay();
 
+    bool prefetchIsEnabled();
+    bool fastStartupEnabled();
+    void markStartupPoint(QString pointName);
+    QString getStorageSystem();
+    QString getAssemblyApp();
+    qint64 getUploadPartSize();
+
 private slots:
     void getAuthReply(RequestState authReply);
     void subWindowHidden(bool nowVisible);
     void newConnectionState(RemoteDataInterfaceState newState);
     void shutdownCallback();
+    void jobStatusNotified(QString jobID, QString jobStatus);
+    void notifiedJobRefresh();
 
 public slots:
     void shutdown();
 
 protected:
-    QNetworkAccessManager * theNetManager = nullptr;
+    TrafficNetManager * theNetManager = nullptr;
     QThread * remoteInterfacesThread = nullptr;
 
     AuthForm * authWindow = nullptr;
@@ -93,11 +119,36 @@ protected:
     AgaveHandler * myDataInterface = nullptr;
     JobOperator * myJobHandle = nullptr;
     FileOperator * myFileHandle = nullptr;
+    TransferJournal * myTransferJournal = nullptr;
+    FileBufferCache * myBufferCache = nullptr;
+    DiskWriterPool * myDiskWriter = nullptr;
+    StallWatchdog * myStallWatchdog = nullptr;
+    JobNotificationListener * myNotificationListener = nullptr;
+    QTimer notificationRefreshTimer;
 
     static QStringList enabledDebugs;
     bool shutdownStarted = false;
     bool debugLoggingEnabled = false;
     bool offlineMode = false;
+    bool prefetchEnabled = false;
+    int shutdownDeadline = 10;
+    int bufferCacheMB = 256;
+    bool spillFileBuffers = false;
+    int notificationPort = 0;
+    QString notificationHost;
+    QString notificationBind;
+    QString storageSystem = "designsafe.storage.default";
+    QString assemblyAppID;
+    int uploadPartMB = 64;
+    int stallThresholdMs = 250;
+    bool fastStartup = false;
+    int warmConnections = 2;
+    int httpCacheMB = 50;
+    QElapsedTimer startupClock;
+
+    TrafficMode trafficMode;
+    QString trafficFileName;
+    double replaySpeed = 1.0;
 };
 
 #endif // AGAVESETUPDRIVER_H
@@ -0,0 +1,519 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "batchengine.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QJsonObject>
+
+#include "utilFuncs/agavesession.h"
+#include "remotedatainterface.h"
+
+#include "ae_globals.h"
+
+static const int JOB_POLL_INTERVAL = 10000;
+static const qint64 DEFAULT_WAIT_TIMEOUT = 24 * 60 * 60 * 1000;
+
+BatchEngine::BatchEngine(AgaveSession * theSession, int maxParallel, QObject *parent) : QObject(parent)
+{
+    mySession = theSession;
+    myMaxParallel = qMax(1, maxParallel);
+    myWaitTimeout = DEFAULT_WAIT_TIMEOUT;
+
+    QObject::connect(&jobPollTimer, SIGNAL(timeout()), this, SLOT(pollWaitingJobs()));
+}
+
+bool BatchEngine::loadScript(QString scriptFileName, QString * errorText)
+{
+    QFile scriptFile(scriptFileName);
+    if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        if (errorText != nullptr) *errorText = QString("Unable to open batch script: %1").arg(scriptFileName);
+        return false;
+    }
+
+    stepList.clear();
+    stepNames.clear();
+
+    QTextStream scriptStream(&scriptFile);
+    int lineNum = 0;
+    while (!scriptStream.atEnd())
+    {
+        QString stepLine = scriptStream.readLine().trimmed();
+        lineNum++;
+        if (stepLine.isEmpty() || stepLine.startsWith('#')) continue;
+
+        if (!parseStep(stepLine, lineNum, errorText)) return false;
+    }
+
+    inferDependencies();
+    return true;
+}
+
+void BatchEngine::start()
+{
+    batchTimer.start();
+    scheduleSteps();
+}
+
+void BatchEngine::setWaitTimeout(qint64 timeoutMs)
+{
+    if (timeoutMs > 0) myWaitTimeout = timeoutMs;
+}
+
+int BatchEngine::getFailedCount()
+{
+    int failedCount = 0;
+    for (const BatchStep &aStep : stepList)
+    {
+        if ((aStep.state == BatchStepState::FAILED) || (aStep.state == BatchStepState::SKIPPED)) failedCount++;
+    }
+    return failedCount;
+}
+
+QString BatchEngine::getReport()
+{
+    QStringList reportLines;
+    for (const BatchStep &aStep : stepList)
+    {
+        QString stateText;
+        switch (aStep.state)
+        {
+        case BatchStepState::WAITING: stateText = "not run"; break;
+        case BatchStepState::RUNNING: stateText = "running"; break;
+        case BatchStepState::DONE: stateText = "done"; break;
+        case BatchStepState::FAILED: stateText = "FAILED"; break;
+        case BatchStepState::SKIPPED: stateText = "skipped"; break;
+        }
+        reportLines.append(QString("%1 (%2): %3, %4 ms").arg(aStep.name, aStep.command, stateText).arg(aStep.elapsedMs));
+    }
+    reportLines.append(QString("Batch time: %1 ms").arg(batchTimer.elapsed()));
+    return reportLines.join('\n');
+}
+
+void BatchEngine::fileStepReply(RequestState replyState)
+{
+    int stepIndex = stepForReply(sender());
+    if (stepIndex < 0) return;
+
+    finishStep(stepIndex, (replyState == RequestState::GOOD));
+}
+
+void BatchEngine::submitStepReply(RequestState replyState, QJsonDocument rawReply)
+{
+    int stepIndex = stepForReply(sender());
+    if (stepIndex < 0) return;
+
+    stepList[stepIndex].jobID = rawReply.object().value("result").toObject().value("id").toString();
+    finishStep(stepIndex, (replyState == RequestState::GOOD) && !stepList[stepIndex].jobID.isEmpty());
+}
+
+void BatchEngine::jobDetailsReply(RequestState replyState, RemoteJobData jobData)
+{
+    int stepIndex = stepForReply(sender());
+    if (stepIndex < 0) return;
+    if (replyState != RequestState::GOOD) return;
+
+    QString jobState = jobData.getState();
+    if (jobState == "FINISHED")
+    {
+        waitingJobSteps.remove(stepIndex);
+        finishStep(stepIndex, true);
+    }
+    else if ((jobState == "FAILED") || (jobState == "STOPPED"))
+    {
+        waitingJobSteps.remove(stepIndex);
+        finishStep(stepIndex, false);
+    }
+}
+
+void BatchEngine::pollWaitingJobs()
+{
+    if (waitingJobSteps.isEmpty())
+    {
+        jobPollTimer.stop();
+        return;
+    }
+
+    for (int stepIndex : waitingJobSteps.values())
+    {
+        const BatchStep &theStep = stepList.at(stepIndex);
+        qint64 stepTimeout = (theStep.timeoutMs > 0) ? theStep.timeoutMs : myWaitTimeout;
+        if (theStep.stepTimer.elapsed() > stepTimeout)
+        {
+            qCDebug(agaveAppLayer, "Batch step %s: job %s did not end in time", qPrintable(theStep.name), qPrintable(theStep.jobID));
+            waitingJobSteps.remove(stepIndex);
+            finishStep(stepIndex, false);
+            continue;
+        }
+
+        //Do not stack up polls on a slow server
+        if (pendingReplies.values().contains(stepIndex)) continue;
+
+        RemoteDataReply * theReply = mySession->getDataConnection()->getJobDetails(stepList.at(stepIndex).jobID);
+        if (theReply == nullptr) continue;
+
+        pendingReplies.insert(theReply, stepIndex);
+        QObject::connect(theReply, SIGNAL(haveJobDetails(RequestState,RemoteJobData)), this, SLOT(jobDetailsReply(RequestState,RemoteJobData)));
+    }
+}
+
+bool BatchEngine::parseStep(QString stepLine, int lineNum, QString * errorText)
+{
+    QStringList tokens = tokenize(stepLine);
+    BatchStep newStep;
+    newStep.name = QString("line%1").arg(lineNum);
+
+    if (!tokens.isEmpty() && tokens.first().endsWith(':'))
+    {
+        newStep.name = tokens.takeFirst();
+        newStep.name.chop(1);
+    }
+
+    int afterIndex = tokens.indexOf("after");
+    if ((afterIndex >= 0) && (afterIndex + 1 < tokens.size()))
+    {
+        for (QString aName : tokens.at(afterIndex + 1).split(',', QString::SkipEmptyParts))
+        {
+            if (!stepNames.contains(aName))
+            {
+                if (errorText != nullptr) *errorText = QString("Line %1: unknown step %2").arg(lineNum).arg(aName);
+                return false;
+            }
+            newStep.dependsOn.insert(stepNames.value(aName));
+        }
+        tokens = tokens.mid(0, afterIndex);
+    }
+
+    if (tokens.isEmpty())
+    {
+        if (errorText != nullptr) *errorText = QString("Line %1: missing command").arg(lineNum);
+        return false;
+    }
+    newStep.command = tokens.takeFirst().toLower();
+    newStep.args = tokens;
+
+    int minArgs = 2;
+    if ((newStep.command == "delete") || (newStep.command == "wait")) minArgs = 1;
+    if (newStep.args.size() < minArgs)
+    {
+        if (errorText != nullptr) *errorText = QString("Line %1: too few arguments for %2").arg(lineNum).arg(newStep.command);
+        return false;
+    }
+
+    const QStringList &args = newStep.args;
+    if (newStep.command == "mkdir")
+    {
+        newStep.reads << args.at(0);
+        newStep.writes << QString("%1/%2").arg(args.at(0), args.at(1));
+    }
+    else if (newStep.command == "upload")
+    {
+        newStep.reads << QString("local:%1").arg(args.at(0));
+        newStep.writes << QString("%1/%2").arg(args.at(1), QFileInfo(args.at(0)).fileName());
+    }
+    else if (newStep.command == "download")
+    {
+        newStep.reads << args.at(0);
+        newStep.writes << QString("local:%1").arg(args.at(1));
+    }
+    else if (newStep.command == "copy")
+    {
+        newStep.reads << args.at(0);
+        newStep.writes << args.at(1);
+    }
+    else if (newStep.command == "move")
+    {
+        newStep.writes << args.at(0) << args.at(1);
+    }
+    else if (newStep.command == "delete")
+    {
+        newStep.writes << args.at(0);
+    }
+    else if (newStep.command == "submit")
+    {
+        newStep.reads << args.at(1);
+    }
+    else if (newStep.command == "wait")
+    {
+        if (!stepNames.contains(args.at(0)) || (stepList.at(stepNames.value(args.at(0))).command != "submit"))
+        {
+            if (errorText != nullptr) *errorText = QString("Line %1: wait needs the name of an earlier submit step").arg(lineNum);
+            return false;
+        }
+        newStep.dependsOn.insert(stepNames.value(args.at(0)));
+
+        //The job keeps using the submit's folders until it ends, so later writers of them must wait for the job, not just the submit
+        newStep.reads << stepList.at(stepNames.value(args.at(0))).reads;
+
+        if (args.size() > 1)
+        {
+            bool timeoutOK = false;
+            double timeoutMinutes = args.at(1).startsWith("timeout=") ? args.at(1).section('=', 1).toDouble(&timeoutOK) : 0;
+            if (!timeoutOK || (timeoutMinutes <= 0))
+            {
+                if (errorText != nullptr) *errorText = QString("Line %1: wait takes timeout=<minutes>").arg(lineNum);
+                return false;
+            }
+            newStep.timeoutMs = (qint64) (timeoutMinutes * 60 * 1000);
+        }
+    }
+    else
+    {
+        if (errorText != nullptr) *errorText = QString("Line %1: unknown command %2").arg(lineNum).arg(newStep.command);
+        return false;
+    }
+
+    if (stepNames.contains(newStep.name))
+    {
+        if (errorText != nullptr) *errorText = QString("Line %1: duplicate step name %2").arg(lineNum).arg(newStep.name);
+        return false;
+    }
+    stepNames.insert(newStep.name, stepList.size());
+    stepList.append(newStep);
+    return true;
+}
+
+void BatchEngine::inferDependencies()
+{
+    //Only earlier steps are considered, so the result is always acyclic
+    for (int later = 0; later < stepList.size(); later++)
+    {
+        BatchStep &laterStep = stepList[later];
+        for (int earlier = 0; earlier < later; earlier++)
+        {
+            const BatchStep &earlierStep = stepList.at(earlier);
+
+            if (anyOverlap(earlierStep.writes, laterStep.reads) ||
+                    anyOverlap(earlierStep.writes, laterStep.writes) ||
+                    anyOverlap(earlierStep.reads, laterStep.writes))
+            {
+                laterStep.dependsOn.insert(earlier);
+            }
+        }
+    }
+}
+
+void BatchEngine::scheduleSteps()
+{
+    bool anyActive = false;
+
+    for (int i = 0; i < stepList.size(); i++)
+    {
+        BatchStep &aStep = stepList[i];
+        if (aStep.state == BatchStepState::RUNNING) anyActive = true;
+        if (aStep.state != BatchStepState::WAITING) continue;
+
+        bool depsDone = true;
+        bool depsFailed = false;
+        for (int depIndex : aStep.dependsOn)
+        {
+            BatchStepState depState = stepList.at(depIndex).state;
+            if ((depState == BatchStepState::FAILED) || (depState == BatchStepState::SKIPPED)) depsFailed = true;
+            if (depState != BatchStepState::DONE) depsDone = false;
+        }
+
+        if (depsFailed)
+        {
+            aStep.state = BatchStepState::SKIPPED;
+            qCDebug(agaveAppLayer, "Batch step %s skipped", qPrintable(aStep.name));
+            continue;
+        }
+        anyActive = true;
+        if (!depsDone || (runningCount >= myMaxParallel)) continue;
+
+        if (!launchStep(i))
+        {
+            aStep.state = BatchStepState::FAILED;
+            qCDebug(agaveAppLayer, "Batch step %s could not be started", qPrintable(aStep.name));
+            scheduleSteps();
+            return;
+        }
+    }
+
+    if (!anyActive && (runningCount == 0))
+    {
+        emit batchFinished(getFailedCount() == 0);
+    }
+}
+
+bool BatchEngine::launchStep(int stepIndex)
+{
+    BatchStep &theStep = stepList[stepIndex];
+    const QStringList &args = theStep.args;
+    RemoteDataInterface * theConnection = mySession->getDataConnection();
+
+    theStep.state = BatchStepState::RUNNING;
+    theStep.stepTimer.start();
+    runningCount++;
+
+    if (theStep.command == "wait")
+    {
+        theStep.jobID = stepList.at(*(theStep.dependsOn.constBegin())).jobID;
+        for (int depIndex : theStep.dependsOn)
+        {
+            if (stepList.at(depIndex).command == "submit") theStep.jobID = stepList.at(depIndex).jobID;
+        }
+        waitingJobSteps.insert(stepIndex);
+        if (!jobPollTimer.isActive())
+        {
+            jobPollTimer.start(JOB_POLL_INTERVAL);
+        }
+        return true;
+    }
+
+    RemoteDataReply * theReply = nullptr;
+    if (theStep.command == "mkdir")
+    {
+        theReply = theConnection->mkRemoteDir(args.at(0), args.at(1));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveMkdirReply(RequestState,FileMetaData)), this, SLOT(fileStepReply(RequestState)));
+    }
+    else if (theStep.command == "upload")
+    {
+        theReply = theConnection->uploadFile(args.at(1), args.at(0));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveUploadReply(RequestState,FileMetaData)), this, SLOT(fileStepReply(RequestState)));
+    }
+    else if (theStep.command == "download")
+    {
+        theReply = theConnection->downloadFile(args.at(1), args.at(0));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveDownloadReply(RequestState)), this, SLOT(fileStepReply(RequestState)));
+    }
+    else if (theStep.command == "copy")
+    {
+        theReply = theConnection->copyFile(args.at(0), args.at(1));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveCopyReply(RequestState,FileMetaData)), this, SLOT(fileStepReply(RequestState)));
+    }
+    else if (theStep.command == "move")
+    {
+        theReply = theConnection->moveFile(args.at(0), args.at(1));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveMoveReply(RequestState,FileMetaData)), this, SLOT(fileStepReply(RequestState)));
+    }
+    else if (theStep.command == "delete")
+    {
+        theReply = theConnection->deleteFile(args.at(0));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveDeleteReply(RequestState)), this, SLOT(fileStepReply(RequestState)));
+    }
+    else if (theStep.command == "submit")
+    {
+        QMultiMap<QString, QString> jobParams;
+        for (int i = 2; i < args.size(); i++)
+        {
+            jobParams.insert(args.at(i).section('=', 0, 0), args.at(i).section('=', 1));
+        }
+        theReply = theConnection->runRemoteJob(args.at(0), jobParams, args.at(1));
+        if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveJobReply(RequestState,QJsonDocument)), this, SLOT(submitStepReply(RequestState,QJsonDocument)));
+    }
+
+    if (theReply == nullptr)
+    {
+        runningCount--;
+        return false;
+    }
+    pendingReplies.insert(theReply, stepIndex);
+    return true;
+}
+
+void BatchEngine::finishStep(int stepIndex, bool succeeded)
+{
+    BatchStep &theStep = stepList[stepIndex];
+    if (theStep.state != BatchStepState::RUNNING) return;
+
+    theStep.state = succeeded ? BatchStepState::DONE : BatchStepState::FAILED;
+    theStep.elapsedMs = theStep.stepTimer.elapsed();
+    runningCount--;
+    qCDebug(agaveAppLayer, "Batch step %s %s in %lld ms", qPrintable(theStep.name), succeeded ? "done" : "failed", theStep.elapsedMs);
+
+    scheduleSteps();
+}
+
+int BatchEngine::stepForReply(QObject * theReply)
+{
+    if (!pendingReplies.contains(theReply)) return -1;
+    return pendingReplies.take(theReply);
+}
+
+QStringList BatchEngine::tokenize(QString stepLine)
+{
+    QStringList tokens;
+    QString currentToken;
+    bool inQuotes = false;
+    bool haveToken = false;
+
+    for (QChar aLetter : stepLine)
+    {
+        if (aLetter == '"')
+        {
+            inQuotes = !inQuotes;
+            haveToken = true;
+            continue;
+        }
+        if (aLetter.isSpace() && !inQuotes)
+        {
+            if (haveToken) tokens.append(currentToken);
+            currentToken.clear();
+            haveToken = false;
+            continue;
+        }
+        currentToken.append(aLetter);
+        haveToken = true;
+    }
+    if (haveToken) tokens.append(currentToken);
+    return tokens;
+}
+
+bool BatchEngine::pathsOverlap(QString path1, QString path2)
+{
+    if (path1.endsWith('/')) path1.chop(1);
+    if (path2.endsWith('/')) path2.chop(1);
+
+    if (path1 == path2) return true;
+    if (path1.startsWith(path2 + '/')) return true;
+    if (path2.startsWith(path1 + '/')) return true;
+    return false;
+}
+
+bool BatchEngine::anyOverlap(const QStringList &paths1, const QStringList &paths2)
+{
+    for (const QString &path1 : paths1)
+    {
+        for (const QString &path2 : paths2)
+        {
+            if (pathsOverlap(path1, path2)) return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,142 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef BATCHENGINE_H
+#define BATCHENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QMap>
+#include <QSet>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+
+#include "remotejobdata.h"
+
+class AgaveSession;
+enum class RequestState;
+
+enum class BatchStepState {WAITING, RUNNING, DONE, FAILED, SKIPPED};
+
+/*! \brief The BatchEngine runs a script of remote file and job operations for one AgaveSession, doing independent steps in parallel.
+ *
+ *  A batch script has one step per line. Blank lines, and lines starting with #, are ignored. Each step is:
+ *
+ *  [name:] command arguments... [after name1,name2]
+ *
+ *  The commands are:
+ *  mkdir <remoteFolder> <newName>
+ *  upload <localFile> <remoteFolder>
+ *  download <remoteFile> <localFile>
+ *  copy <remoteFrom> <remoteTo>
+ *  move <remoteFrom> <remoteTo>
+ *  delete <remotePath>
+ *  submit <app> <remoteWorkingDir> [param=value ...]
+ *  wait <submitStepName> [timeout=<minutes>]
+ *
+ *  A step waits for the steps named in its "after" list. It also waits for any earlier step which writes a path it uses, or uses a path it writes, where paths under a folder count as that folder. Everything else runs in parallel, up to a limit.
+ *  A submit step is done once the job is accepted, but a wait step for it also counts as using the job's working folder, so later steps which write there wait for the job to end.
+ *  Without a wait step, nothing orders later writes after the job itself, and a step which changes the job's folder needs "after" on a wait step.
+ *  If a step fails, the steps which depend on it are skipped.
+ *  A wait step fails if its job has not ended within its timeout, or within the engine's wait timeout if the step gives none.
+ */
+
+class BatchEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchEngine(AgaveSession * theSession, int maxParallel = 8, QObject *parent = nullptr);
+
+    bool loadScript(QString scriptFileName, QString * errorText = nullptr);
+    void start();
+    void setWaitTimeout(qint64 timeoutMs);
+
+    int getFailedCount();
+    QString getReport();
+
+signals:
+    void batchFinished(bool allSucceeded);
+
+private slots:
+    void fileStepReply(RequestState replyState);
+    void submitStepReply(RequestState replyState, QJsonDocument rawReply);
+    void jobDetailsReply(RequestState replyState, RemoteJobData jobData);
+    void pollWaitingJobs();
+
+private:
+    struct BatchStep
+    {
+        QString name;
+        QString command;
+        QStringList args;
+        QStringList reads;
+        QStringList writes;
+        QSet<int> dependsOn;
+
+        BatchStepState state = BatchStepState::WAITING;
+        QString jobID;
+        qint64 timeoutMs = 0;
+        QElapsedTimer stepTimer;
+        qint64 elapsedMs = 0;
+    };
+
+    bool parseStep(QString stepLine, int lineNum, QString * errorText);
+    void inferDependencies();
+    void scheduleSteps();
+    bool launchStep(int stepIndex);
+    void finishStep(int stepIndex, bool succeeded);
+    int stepForReply(QObject * theReply);
+
+    static QStringList tokenize(QString stepLine);
+    static bool pathsOverlap(QString path1, QString path2);
+    static bool anyOverlap(const QStringList &paths1, const QStringList &paths2);
+
+    AgaveSession * mySession;
+    int myMaxParallel;
+    qint64 myWaitTimeout;
+
+    QList<BatchStep> stepList;
+    QMap<QString, int> stepNames;
+    QMap<QObject *, int> pendingReplies;
+    QSet<int> waitingJobSteps;
+
+    int runningCount = 0;
+    QTimer jobPollTimer;
+    QElapsedTimer batchTimer;
+};
+
+#endif // BATCHENGINE_H
@@ -0,0 +1,210 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "bulkfileoperation.h"
+
+#include <QProgressDialog>
+#include <QSet>
+
+#include "remotedatainterface.h"
+#include "filemetadata.h"
+#include "remoteFiles/fileoperator.h"
+#include "remoteFiles/filenoderef.h"
+
+#include "ae_globals.h"
+
+BulkFileOperation::BulkFileOperation(BulkOpType opType, QStringList targetPaths, QString destFolder, FileOperator * theFileHandle, QWidget * parentWindow, int maxParallel) : QObject(parentWindow)
+{
+    myType = opType;
+    waitingPaths = targetPaths;
+    myDestFolder = destFolder;
+    myFileHandle = theFileHandle;
+    myConnection = ae_globals::get_connection();
+    myMaxParallel = qMax(1, maxParallel);
+    totalCount = waitingPaths.size();
+
+    QString labelText;
+    switch (myType)
+    {
+    case BulkOpType::COPY: labelText = QString("Copying %1 items to %2").arg(totalCount).arg(myDestFolder); break;
+    case BulkOpType::MOVE: labelText = QString("Moving %1 items to %2").arg(totalCount).arg(myDestFolder); break;
+    case BulkOpType::REMOVE: labelText = QString("Deleting %1 items").arg(totalCount); break;
+    }
+
+    progressDialog = new QProgressDialog(labelText, "Cancel", 0, totalCount, parentWindow);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(500);
+    QObject::connect(progressDialog, SIGNAL(canceled()), this, SLOT(cancelRequested()));
+}
+
+BulkFileOperation::~BulkFileOperation()
+{
+    progressDialog->deleteLater();
+}
+
+void BulkFileOperation::start()
+{
+    running = true;
+    progressDialog->setValue(0);
+    sendMoreRequests();
+}
+
+bool BulkFileOperation::isRunning()
+{
+    return running;
+}
+
+QStringList BulkFileOperation::pathsFromSelection(QModelIndexList selectedRows)
+{
+    QStringList selectedPaths;
+    for (QModelIndex anIndex : selectedRows)
+    {
+        QStringList pathParts;
+        QModelIndex walkIndex = anIndex.sibling(anIndex.row(), 0);
+        while (walkIndex.isValid())
+        {
+            pathParts.prepend(walkIndex.data().toString());
+            walkIndex = walkIndex.parent();
+        }
+
+        //The top entry is the user's own folder, which is never operated on
+        if (pathParts.size() < 2) continue;
+        selectedPaths.append(QString("/").append(pathParts.join('/')));
+    }
+
+    //If a folder is selected, its selected contents go along with it, so any path below another selected path is dropped
+    selectedPaths.sort();
+    selectedPaths.removeDuplicates();
+    QSet<RemotePath> selectedSet;
+    for (const QString &aPath : selectedPaths)
+    {
+        selectedSet.insert(RemotePath(aPath));
+    }
+
+    QStringList outerPaths;
+    for (const QString &aPath : selectedPaths)
+    {
+        bool insideSelection = false;
+        for (RemotePath ancestorPath = RemotePath(aPath).getParent(); !insideSelection; ancestorPath = ancestorPath.getParent())
+        {
+            if (selectedSet.contains(ancestorPath)) insideSelection = true;
+            if (ancestorPath.isRoot()) break;
+        }
+        if (!insideSelection) outerPaths.append(aPath);
+    }
+    return outerPaths;
+}
+
+void BulkFileOperation::itemReply(RequestState replyState)
+{
+    if (!pendingReplies.contains(sender())) return;
+    QString itemPath = pendingReplies.take(sender());
+
+    if (replyState == RequestState::GOOD)
+    {
+        succeededCount++;
+    }
+    else
+    {
+        failedCount++;
+        qCDebug(agaveAppLayer, "Bulk operation failed on: %s", qPrintable(itemPath));
+    }
+    progressDialog->setValue(succeededCount + failedCount);
+
+    sendMoreRequests();
+}
+
+void BulkFileOperation::cancelRequested()
+{
+    cancelled = true;
+    waitingPaths.clear();
+
+    if (pendingReplies.isEmpty()) finishOperation();
+}
+
+void BulkFileOperation::sendMoreRequests()
+{
+    while (!cancelled && !waitingPaths.isEmpty() && (pendingReplies.size() < myMaxParallel))
+    {
+        QString itemPath = waitingPaths.takeFirst();
+        QString itemName = itemPath.section('/', -1);
+        QString destPath = QString("%1/%2").arg(myDestFolder, itemName);
+
+        RemoteDataReply * theReply = nullptr;
+        switch (myType)
+        {
+        case BulkOpType::COPY:
+            theReply = myConnection->copyFile(itemPath, destPath);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveCopyReply(RequestState,FileMetaData)), this, SLOT(itemReply(RequestState)));
+            break;
+        case BulkOpType::MOVE:
+            theReply = myConnection->moveFile(itemPath, destPath);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveMoveReply(RequestState,FileMetaData)), this, SLOT(itemReply(RequestState)));
+            break;
+        case BulkOpType::REMOVE:
+            theReply = myConnection->deleteFile(itemPath);
+            if (theReply != nullptr) QObject::connect(theReply, SIGNAL(haveDeleteReply(RequestState)), this, SLOT(itemReply(RequestState)));
+            break;
+        }
+
+        if (theReply == nullptr)
+        {
+            failedCount++;
+            continue;
+        }
+        pendingReplies.insert(theReply, itemPath);
+
+        if (myType != BulkOpType::COPY) changedFolders.insert(RemotePath(itemPath).getParent());
+        if (myType != BulkOpType::REMOVE) changedFolders.insert(RemotePath(myDestFolder));
+    }
+
+    if (pendingReplies.isEmpty() && running) finishOperation();
+}
+
+void BulkFileOperation::finishOperation()
+{
+    running = false;
+    progressDialog->reset();
+
+    for (RemotePath aFolder : changedFolders)
+    {
+        FileNodeRef folderNode = myFileHandle->speculateFileWithName(aFolder.toString(), true);
+        if (folderNode.isNil()) continue;
+        folderNode.enactFolderRefresh();
+    }
+
+    qCDebug(agaveAppLayer, "Bulk operation: %d succeeded, %d failed, %d folders refreshed", succeededCount, failedCount, changedFolders.size());
+    emit bulkOperationDone(succeededCount, failedCount);
+}
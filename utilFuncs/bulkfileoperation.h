@@ -0,0 +1,104 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef BULKFILEOPERATION_H
+#define BULKFILEOPERATION_H
+
+#include <QObject>
+#include <QStringList>
+#include <QSet>
+#include <QMap>
+#include <QModelIndexList>
+
+#include "utilFuncs/remotepath.h"
+
+class QProgressDialog;
+class QWidget;
+class RemoteDataInterface;
+class FileOperator;
+enum class RequestState;
+
+enum class BulkOpType {COPY, MOVE, REMOVE};
+
+/*! \brief The BulkFileOperation copies, moves or deletes many remote files at once.
+ *
+ *  Requests are sent directly to the RemoteDataInterface, with several in flight at a time, rather than one by one through the FileOperator.
+ *  One progress dialog covers the whole operation, and cancelling it stops new requests from being sent.
+ *  The folders which were changed are refreshed once, after the last request finishes.
+ */
+
+class BulkFileOperation : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BulkFileOperation(BulkOpType opType, QStringList targetPaths, QString destFolder, FileOperator * theFileHandle, QWidget * parentWindow, int maxParallel = 6);
+    ~BulkFileOperation();
+
+    void start();
+    bool isRunning();
+
+    static QStringList pathsFromSelection(QModelIndexList selectedRows);
+
+signals:
+    void bulkOperationDone(int succeeded, int failed);
+
+private slots:
+    void itemReply(RequestState replyState);
+    void cancelRequested();
+
+private:
+    void sendMoreRequests();
+    void finishOperation();
+
+    BulkOpType myType;
+    QStringList waitingPaths;
+    QString myDestFolder;
+    FileOperator * myFileHandle;
+    RemoteDataInterface * myConnection;
+    int myMaxParallel;
+
+    QMap<QObject *, QString> pendingReplies;
+    QSet<RemotePath> changedFolders;
+
+    QProgressDialog * progressDialog = nullptr;
+    int totalCount;
+    int succeededCount = 0;
+    int failedCount = 0;
+    bool running = false;
+    bool cancelled = false;
+};
+
+#endif // BULKFILEOPERATION_H
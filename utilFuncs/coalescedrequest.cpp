@@ -0,0 +1,293 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "coalescedrequest.h"
+
+#include "trafficnetmanager.h"
+
+//Past this much data, late callers get a fresh request instead of a copy
+static const int COALESCE_DATA_LIMIT = 4 * 1024 * 1024;
+
+CoalescedRequest::CoalescedRequest(QNetworkReply * realReply, QString requestKey, TrafficNetManager * manager) : QObject(manager)
+{
+    myRealReply = realReply;
+    myRealReply->setParent(this);
+    myKey = requestKey;
+    myManager = manager;
+
+    QObject::connect(myRealReply, SIGNAL(metaDataChanged()), this, SLOT(realMetaDataChanged()));
+    QObject::connect(myRealReply, SIGNAL(readyRead()), this, SLOT(realDataReady()));
+    QObject::connect(myRealReply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(realDownloadProgress(qint64,qint64)));
+    QObject::connect(myRealReply, SIGNAL(finished()), this, SLOT(realFinished()));
+}
+
+CoalescedRequest::~CoalescedRequest() {}
+
+bool CoalescedRequest::acceptingWaiters()
+{
+    //Without a buffer, a caller joining now would miss the data already passed on
+    return !realReplyDone && !dataLimitPassed && ((bytesSeen == 0) || bufferingData);
+}
+
+CoalescedReply * CoalescedRequest::addWaiter(QNetworkAccessManager::Operation op, const QNetworkRequest &req)
+{
+    CoalescedReply * newWaiter = new CoalescedReply(op, req, this, myManager);
+
+    //Data is kept only for shared reads, and a second caller can only join before any has arrived
+    if (!waiters.isEmpty())
+    {
+        bufferingData = true;
+    }
+
+    if (haveMetaData)
+    {
+        newWaiter->takeMetaData(myRealReply);
+    }
+    if (!receivedData.isEmpty())
+    {
+        newWaiter->takeData(receivedData);
+    }
+
+    waiters.append(newWaiter);
+    return newWaiter;
+}
+
+void CoalescedRequest::removeWaiter(CoalescedReply * waiter)
+{
+    waiters.removeAll(waiter);
+
+    if (waiters.isEmpty() && !realReplyDone)
+    {
+        myRealReply->abort();
+    }
+}
+
+void CoalescedRequest::realMetaDataChanged()
+{
+    haveMetaData = true;
+    for (QPointer<CoalescedReply> aWaiter : waiters)
+    {
+        if (!aWaiter.isNull()) aWaiter->takeMetaData(myRealReply);
+    }
+}
+
+void CoalescedRequest::realDataReady()
+{
+    QByteArray newData = myRealReply->readAll();
+    if (newData.isEmpty()) return;
+
+    bytesSeen += newData.size();
+    if (!bufferingData)
+    {
+        //No one else can join from here, so the key is freed for a fresh request
+        myManager->releaseCoalescedRead(myKey, this);
+    }
+    else if (!dataLimitPassed)
+    {
+        receivedData.append(newData);
+        if (receivedData.size() > COALESCE_DATA_LIMIT)
+        {
+            dataLimitPassed = true;
+            receivedData.clear();
+            myManager->releaseCoalescedRead(myKey, this);
+        }
+    }
+
+    for (QPointer<CoalescedReply> aWaiter : waiters)
+    {
+        if (!aWaiter.isNull()) aWaiter->takeData(newData);
+    }
+}
+
+void CoalescedRequest::realDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    for (QPointer<CoalescedReply> aWaiter : waiters)
+    {
+        if (!aWaiter.isNull()) aWaiter->takeProgress(bytesReceived, bytesTotal);
+    }
+}
+
+void CoalescedRequest::realFinished()
+{
+    if (myRealReply->bytesAvailable() > 0)
+    {
+        realDataReady();
+    }
+
+    realReplyDone = true;
+    myManager->releaseCoalescedRead(myKey, this);
+
+    //The server may send a session ticket after the headers, so the final SSL state is passed on too
+    for (QPointer<CoalescedReply> aWaiter : waiters)
+    {
+        if (aWaiter.isNull()) continue;
+        aWaiter->takeSslConfiguration(myRealReply->sslConfiguration());
+        aWaiter->takeFinish(myRealReply->error(), myRealReply->errorString());
+    }
+    waiters.clear();
+    receivedData.clear();
+
+    this->deleteLater();
+}
+
+CoalescedReply::CoalescedReply(QNetworkAccessManager::Operation op, const QNetworkRequest &req, CoalescedRequest * source, QObject *parent) :
+    QNetworkReply(parent)
+{
+    mySource = source;
+
+    setOperation(op);
+    setRequest(req);
+    setUrl(req.url());
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    QMetaObject::invokeMethod(this, "startDelivery", Qt::QueuedConnection);
+}
+
+void CoalescedReply::abort()
+{
+    if (replyDone) return;
+
+    if (!mySource.isNull())
+    {
+        mySource->removeWaiter(this);
+    }
+    sourceDone = true;
+    finalError = QNetworkReply::OperationCanceledError;
+    setError(finalError, "Operation canceled");
+    pendingData.clear();
+
+    if (deliveryStarted)
+    {
+        finishDelivery();
+    }
+}
+
+qint64 CoalescedReply::bytesAvailable() const
+{
+    return pendingData.size() + QIODevice::bytesAvailable();
+}
+
+bool CoalescedReply::isSequential() const
+{
+    return true;
+}
+
+qint64 CoalescedReply::readData(char *data, qint64 maxSize)
+{
+    qint64 readSize = qMin(maxSize, (qint64) pendingData.size());
+    memcpy(data, pendingData.constData(), readSize);
+    pendingData.remove(0, readSize);
+    return readSize;
+}
+
+void CoalescedReply::takeMetaData(QNetworkReply * realReply)
+{
+    if (sourceDone) return;
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, realReply->attribute(QNetworkRequest::HttpStatusCodeAttribute));
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, realReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    setAttribute(QNetworkRequest::RedirectionTargetAttribute, realReply->attribute(QNetworkRequest::RedirectionTargetAttribute));
+    setAttribute(QNetworkRequest::SourceIsFromCacheAttribute, realReply->attribute(QNetworkRequest::SourceIsFromCacheAttribute));
+    for (const QNetworkReply::RawHeaderPair &aHeader : realReply->rawHeaderPairs())
+    {
+        setRawHeader(aHeader.first, aHeader.second);
+    }
+    sourceSslConfig = realReply->sslConfiguration();
+    haveMetaData = true;
+
+    if (deliveryStarted) emit metaDataChanged();
+}
+
+void CoalescedReply::takeSslConfiguration(const QSslConfiguration &sslConfig)
+{
+    sourceSslConfig = sslConfig;
+}
+
+void CoalescedReply::sslConfigurationImplementation(QSslConfiguration &configuration) const
+{
+    configuration = sourceSslConfig;
+}
+
+void CoalescedReply::takeData(QByteArray newData)
+{
+    if (sourceDone) return;
+
+    pendingData.append(newData);
+    if (deliveryStarted) emit readyRead();
+}
+
+void CoalescedReply::takeProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    if (sourceDone) return;
+
+    if (deliveryStarted) emit downloadProgress(bytesReceived, bytesTotal);
+}
+
+void CoalescedReply::takeFinish(QNetworkReply::NetworkError errorCode, QString errorText)
+{
+    if (sourceDone) return;
+
+    sourceDone = true;
+    finalError = errorCode;
+    if (finalError != QNetworkReply::NoError)
+    {
+        setError(finalError, errorText);
+    }
+
+    if (deliveryStarted) finishDelivery();
+}
+
+void CoalescedReply::startDelivery()
+{
+    if (deliveryStarted) return;
+    deliveryStarted = true;
+
+    if (haveMetaData) emit metaDataChanged();
+    if (!pendingData.isEmpty()) emit readyRead();
+    if (sourceDone) finishDelivery();
+}
+
+void CoalescedReply::finishDelivery()
+{
+    if (replyDone) return;
+    replyDone = true;
+
+    if (finalError != QNetworkReply::NoError)
+    {
+        emit error(finalError);
+    }
+    setFinished(true);
+    emit finished();
+}
@@ -0,0 +1,129 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef COALESCEDREQUEST_H
+#define COALESCEDREQUEST_H
+
+#include <QObject>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QSslConfiguration>
+
+class TrafficNetManager;
+class CoalescedReply;
+
+/*! \brief A CoalescedRequest is a single network read, shared by every caller who asked for the same thing while it was in flight.
+ *
+ *  Each caller gets its own CoalescedReply, which receives a copy of the headers, cache and SSL attributes, data and final state of the one real reply.
+ *  Data is only kept once a second caller has joined, and a second caller can only join before any data has arrived. A read with one caller is never buffered, and new callers are turned away once data is flowing.
+ *  Callers who join after that are given everything received so far. Once the received data passes a size limit, no new callers are accepted, so large downloads are not held in memory twice.
+ */
+
+class CoalescedRequest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CoalescedRequest(QNetworkReply * realReply, QString requestKey, TrafficNetManager * manager);
+    ~CoalescedRequest();
+
+    bool acceptingWaiters();
+    CoalescedReply * addWaiter(QNetworkAccessManager::Operation op, const QNetworkRequest &req);
+    void removeWaiter(CoalescedReply * waiter);
+
+private slots:
+    void realMetaDataChanged();
+    void realDataReady();
+    void realDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void realFinished();
+
+private:
+    QNetworkReply * myRealReply;
+    QString myKey;
+    TrafficNetManager * myManager;
+
+    QList<QPointer<CoalescedReply>> waiters;
+    QByteArray receivedData;
+    qint64 bytesSeen = 0;
+    bool bufferingData = false;
+    bool haveMetaData = false;
+    bool realReplyDone = false;
+    bool dataLimitPassed = false;
+};
+
+/*! \brief The CoalescedReply is the reply object handed to one caller of a CoalescedRequest.
+ *
+ *  No signals are emitted until control returns to the event loop, so that the caller always has the chance to connect to the reply first.
+ */
+
+class CoalescedReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    explicit CoalescedReply(QNetworkAccessManager::Operation op, const QNetworkRequest &req, CoalescedRequest * source, QObject *parent = nullptr);
+
+    virtual void abort();
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const;
+
+    void takeMetaData(QNetworkReply * realReply);
+    void takeSslConfiguration(const QSslConfiguration &sslConfig);
+    void takeData(QByteArray newData);
+    void takeProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void takeFinish(QNetworkReply::NetworkError errorCode, QString errorText);
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxSize);
+    virtual void sslConfigurationImplementation(QSslConfiguration &configuration) const;
+
+private slots:
+    void startDelivery();
+
+private:
+    void finishDelivery();
+
+    QPointer<CoalescedRequest> mySource;
+    QByteArray pendingData;
+    QSslConfiguration sourceSslConfig;
+
+    QNetworkReply::NetworkError finalError = QNetworkReply::NoError;
+    bool deliveryStarted = false;
+    bool haveMetaData = false;
+    bool sourceDone = false;
+    bool replyDone = false;
+};
+
+#endif // COALESCEDREQUEST_H
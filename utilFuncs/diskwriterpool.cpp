@@ -0,0 +1,282 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "diskwriterpool.h"
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(Q_OS_WIN)
+#include <io.h>
+#include <windows.h>
+#endif
+
+#include "ae_globals.h"
+
+DiskWriterPool::DiskWriterPool(int threadCount, qint64 highWaterBytes, QObject *parent) : QObject(parent)
+{
+    myHighWater = highWaterBytes;
+
+    for (int i = 0; i < qMax(1, threadCount); i++)
+    {
+        QThread * newThread = new QThread(this);
+        DiskWriterWorker * newWorker = new DiskWriterWorker();
+        newWorker->moveToThread(newThread);
+        QObject::connect(newThread, SIGNAL(finished()), newWorker, SLOT(deleteLater()));
+
+        QObject::connect(newWorker, SIGNAL(chunkWritten(qint64)), this, SLOT(chunkWritten(qint64)));
+        QObject::connect(newWorker, SIGNAL(fileClosed(int,bool,qint64,QString)), this, SLOT(workerClosedFile(int,bool,qint64,QString)));
+
+        newThread->start();
+        writerThreads.append(newThread);
+        writerList.append(newWorker);
+    }
+}
+
+DiskWriterPool::~DiskWriterPool()
+{
+    //Blocking calls run after the writes already queued, so all data is on disk before the threads stop
+    for (DiskWriterWorker * aWorker : writerList)
+    {
+        QMetaObject::invokeMethod(aWorker, "closeAllFiles", Qt::BlockingQueuedConnection);
+    }
+    for (QThread * aThread : writerThreads)
+    {
+        aThread->quit();
+        aThread->wait();
+    }
+}
+
+int DiskWriterPool::openFile(QString fileName, qint64 expectedSize)
+{
+    int newID = nextFileID++;
+    QMetaObject::invokeMethod(workerFor(newID), "openFile", Qt::QueuedConnection,
+                              Q_ARG(int, newID), Q_ARG(QString, fileName), Q_ARG(qint64, expectedSize));
+    return newID;
+}
+
+void DiskWriterPool::writeChunk(int fileID, QByteArray data)
+{
+    if (data.isEmpty()) return;
+
+    queuedBytes += data.size();
+    if (queuedBytes > myHighWater)
+    {
+        backedUp = true;
+    }
+    QMetaObject::invokeMethod(workerFor(fileID), "writeChunk", Qt::QueuedConnection,
+                              Q_ARG(int, fileID), Q_ARG(QByteArray, data));
+}
+
+void DiskWriterPool::closeFile(int fileID)
+{
+    QMetaObject::invokeMethod(workerFor(fileID), "closeFile", Qt::QueuedConnection, Q_ARG(int, fileID));
+}
+
+void DiskWriterPool::discardFile(int fileID)
+{
+    QMetaObject::invokeMethod(workerFor(fileID), "discardFile", Qt::QueuedConnection, Q_ARG(int, fileID));
+}
+
+bool DiskWriterPool::isBackedUp()
+{
+    return backedUp;
+}
+
+qint64 DiskWriterPool::getQueuedBytes()
+{
+    return queuedBytes;
+}
+
+void DiskWriterPool::chunkWritten(qint64 chunkSize)
+{
+    queuedBytes -= chunkSize;
+
+    //Resume at half the mark, so reading does not stop and start on every chunk
+    if (backedUp && (queuedBytes < myHighWater / 2))
+    {
+        backedUp = false;
+        emit writerDrained();
+    }
+}
+
+void DiskWriterPool::workerClosedFile(int fileID, bool succeeded, qint64 bytesWritten, QString errorText)
+{
+    emit fileClosed(fileID, succeeded, bytesWritten, errorText);
+}
+
+DiskWriterWorker * DiskWriterPool::workerFor(int fileID)
+{
+    return writerList.at(fileID % writerList.size());
+}
+
+DiskWriterWorker::DiskWriterWorker(QObject *parent) : QObject(parent) {}
+
+DiskWriterWorker::~DiskWriterWorker()
+{
+    for (WriterFile &aFile : fileList)
+    {
+        delete aFile.theFile;
+    }
+}
+
+void DiskWriterWorker::closeAllFiles()
+{
+    for (int fileID : fileList.keys())
+    {
+        closeFile(fileID);
+    }
+}
+
+void DiskWriterWorker::openFile(int fileID, QString fileName, qint64 expectedSize)
+{
+    WriterFile newFile;
+    newFile.theFile = new QFile(fileName);
+
+    if (!newFile.theFile->open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        newFile.errorText = newFile.theFile->errorString();
+    }
+    else if (expectedSize > 0)
+    {
+        //Reserving the blocks up front keeps the file from fragmenting, and finds a full disk early
+        newFile.preallocated = reserveSpace(newFile.theFile, expectedSize);
+    }
+    fileList.insert(fileID, newFile);
+}
+
+bool DiskWriterWorker::reserveSpace(QFile * theFile, qint64 fileSize)
+{
+#if defined(Q_OS_LINUX)
+    //Unlike posix_fallocate, this fails instead of writing zeros on file systems without block reservation
+    return (fallocate(theFile->handle(), 0, 0, fileSize) == 0);
+#elif defined(Q_OS_MACOS)
+    fstore_t storeRequest = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, fileSize, 0};
+    if (fcntl(theFile->handle(), F_PREALLOCATE, &storeRequest) == -1)
+    {
+        storeRequest.fst_flags = F_ALLOCATEALL;
+        if (fcntl(theFile->handle(), F_PREALLOCATE, &storeRequest) == -1) return false;
+    }
+    return true;
+#elif defined(Q_OS_WIN)
+    //NTFS allocates clusters when the end of a non-sparse file is moved
+    return theFile->resize(fileSize);
+#else
+    //Elsewhere, resize() would only leave a sparse file, which reserves nothing
+    Q_UNUSED(theFile);
+    Q_UNUSED(fileSize);
+    return false;
+#endif
+}
+
+bool DiskWriterWorker::syncToDisk(QFile * theFile)
+{
+#if defined(Q_OS_MACOS)
+    //Plain fsync on macOS leaves the data in the drive's cache
+    if (fcntl(theFile->handle(), F_FULLFSYNC) == 0) return true;
+    return (fsync(theFile->handle()) == 0);
+#elif defined(Q_OS_LINUX)
+    return (fdatasync(theFile->handle()) == 0);
+#elif defined(Q_OS_UNIX)
+    return (fsync(theFile->handle()) == 0);
+#elif defined(Q_OS_WIN)
+    return FlushFileBuffers((HANDLE) _get_osfhandle(theFile->handle()));
+#else
+    Q_UNUSED(theFile);
+    return true;
+#endif
+}
+
+void DiskWriterWorker::writeChunk(int fileID, QByteArray data)
+{
+    if (fileList.contains(fileID))
+    {
+        WriterFile &theFile = fileList[fileID];
+        if (theFile.errorText.isEmpty())
+        {
+            if (theFile.theFile->write(data) == data.size())
+            {
+                theFile.bytesWritten += data.size();
+            }
+            else
+            {
+                theFile.errorText = theFile.theFile->errorString();
+            }
+        }
+    }
+    emit chunkWritten(data.size());
+}
+
+void DiskWriterWorker::closeFile(int fileID)
+{
+    if (!fileList.contains(fileID)) return;
+    WriterFile theFile = fileList.take(fileID);
+
+    if (theFile.errorText.isEmpty() && theFile.preallocated && !theFile.theFile->resize(theFile.bytesWritten))
+    {
+        theFile.errorText = theFile.theFile->errorString();
+    }
+    if (theFile.errorText.isEmpty() && !theFile.theFile->flush())
+    {
+        theFile.errorText = theFile.theFile->errorString();
+    }
+    //flush() only hands the data to the OS, which may still lose it in a crash
+    if (theFile.errorText.isEmpty() && !syncToDisk(theFile.theFile))
+    {
+        theFile.errorText = QString("Unable to sync file to disk: %1").arg(theFile.theFile->fileName());
+    }
+    theFile.theFile->close();
+
+    if (!theFile.errorText.isEmpty())
+    {
+        theFile.theFile->remove();
+    }
+    delete theFile.theFile;
+
+    emit fileClosed(fileID, theFile.errorText.isEmpty(), theFile.bytesWritten, theFile.errorText);
+}
+
+void DiskWriterWorker::discardFile(int fileID)
+{
+    if (!fileList.contains(fileID)) return;
+    WriterFile theFile = fileList.take(fileID);
+
+    theFile.theFile->close();
+    theFile.theFile->remove();
+    delete theFile.theFile;
+
+    emit fileClosed(fileID, false, 0, "Discarded");
+}
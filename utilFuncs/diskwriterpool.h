@@ -0,0 +1,125 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef DISKWRITERPOOL_H
+#define DISKWRITERPOOL_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QList>
+#include <QFile>
+
+class DiskWriterWorker;
+
+/*! \brief The DiskWriterPool writes downloaded data to local files on its own threads, so a slow disk does not hold up the thread receiving the data.
+ *
+ *  Each file opened with openFile() is given to one writer thread, which writes its chunks in order. If the expected size is known, disk blocks are reserved for it where the platform allows, and the file is trimmed to the bytes written on close.
+ *  fileClosed() is emitted once all of a file's data has been synced to disk, or has failed to be written.
+ *
+ *  The pool counts the bytes waiting to be written. Past a high-water mark, isBackedUp() is true, and callers should stop reading from the network until writerDrained() is emitted.
+ */
+
+class DiskWriterPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DiskWriterPool(int threadCount = 2, qint64 highWaterBytes = 64 * 1024 * 1024, QObject *parent = nullptr);
+    ~DiskWriterPool();
+
+    int openFile(QString fileName, qint64 expectedSize = 0);
+    void writeChunk(int fileID, QByteArray data);
+    void closeFile(int fileID);
+    void discardFile(int fileID);
+
+    bool isBackedUp();
+    qint64 getQueuedBytes();
+
+signals:
+    void fileClosed(int fileID, bool succeeded, qint64 bytesWritten, QString errorText);
+    void writerDrained();
+
+private slots:
+    void chunkWritten(qint64 chunkSize);
+    void workerClosedFile(int fileID, bool succeeded, qint64 bytesWritten, QString errorText);
+
+private:
+    DiskWriterWorker * workerFor(int fileID);
+
+    QList<QThread *> writerThreads;
+    QList<DiskWriterWorker *> writerList;
+
+    int nextFileID = 1;
+    qint64 queuedBytes = 0;
+    qint64 myHighWater;
+    bool backedUp = false;
+};
+
+class DiskWriterWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DiskWriterWorker(QObject *parent = nullptr);
+    ~DiskWriterWorker();
+
+signals:
+    void chunkWritten(qint64 chunkSize);
+    void fileClosed(int fileID, bool succeeded, qint64 bytesWritten, QString errorText);
+
+public slots:
+    void closeAllFiles();
+    void openFile(int fileID, QString fileName, qint64 expectedSize);
+    void writeChunk(int fileID, QByteArray data);
+    void closeFile(int fileID);
+    void discardFile(int fileID);
+
+private:
+    static bool reserveSpace(QFile * theFile, qint64 fileSize);
+    static bool syncToDisk(QFile * theFile);
+
+    struct WriterFile
+    {
+        QFile * theFile = nullptr;
+        qint64 bytesWritten = 0;
+        bool preallocated = false;
+        QString errorText;
+    };
+
+    QHash<int, WriterFile> fileList;
+};
+
+#endif // DISKWRITERPOOL_H
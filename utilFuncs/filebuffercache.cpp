@@ -0,0 +1,234 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "filebuffercache.h"
+
+#include <QFile>
+#include <QDir>
+#include <QCryptographicHash>
+
+#include "remotedatainterface.h"
+#include "remoteFiles/fileoperator.h"
+
+#include "ae_globals.h"
+
+FileBufferCache::FileBufferCache(qint64 byteBudget, FileOperator * fileHandle, QString spillFolderName, QObject *parent) : QObject(parent)
+{
+    myByteBudget = byteBudget;
+    mySpillFolder = spillFolderName;
+
+    if (!mySpillFolder.isEmpty())
+    {
+        QDir().mkpath(mySpillFolder);
+    }
+
+    pendingClock.start();
+    QObject::connect(&pendingTimer, SIGNAL(timeout()), this, SLOT(checkPendingNodes()));
+    QObject::connect(fileHandle, SIGNAL(fileOpDone(RequestState,QString)), this, SLOT(fileOperationDone(RequestState)));
+}
+
+FileBufferCache::~FileBufferCache()
+{
+    //Spilled buffers only live for one session
+    for (auto itr = spilledBuffers.constBegin(); itr != spilledBuffers.constEnd(); itr++)
+    {
+        QFile::remove(itr.value());
+    }
+}
+
+void FileBufferCache::adoptWhenLoaded(FileNodeRef targetNode)
+{
+    if (targetNode.isNil()) return;
+
+    dropBuffer(RemotePath(targetNode.getFullPath()));
+    pendingNodes.append({targetNode, pendingClock.elapsed()});
+    if (!pendingTimer.isActive())
+    {
+        pendingTimer.start(250);
+    }
+}
+
+void FileBufferCache::insertBuffer(RemotePath remotePath, QByteArray newBuffer)
+{
+    dropBuffer(remotePath);
+
+    MemoryBuffer &newEntry = memoryBuffers[remotePath];
+    newEntry.data = newBuffer;
+    recentUseOrder.insert(nextUseStamp, remotePath);
+    newEntry.useStamp = nextUseStamp++;
+    bytesInMemory += newBuffer.size();
+
+    evictToBudget();
+}
+
+bool FileBufferCache::haveBuffer(RemotePath remotePath)
+{
+    return memoryBuffers.contains(remotePath) || spilledBuffers.contains(remotePath);
+}
+
+QByteArray FileBufferCache::getBuffer(RemotePath remotePath)
+{
+    auto memoryItr = memoryBuffers.find(remotePath);
+    if (memoryItr != memoryBuffers.end())
+    {
+        markUsed(memoryItr.value(), remotePath);
+        return memoryItr.value().data;
+    }
+
+    if (!spilledBuffers.contains(remotePath)) return QByteArray();
+
+    QFile spillFile(spilledBuffers.value(remotePath));
+    if (!spillFile.open(QIODevice::ReadOnly))
+    {
+        qCDebug(agaveAppLayer, "Unable to read spilled file buffer: %s", qPrintable(spillFile.fileName()));
+        dropBuffer(remotePath);
+        return QByteArray();
+    }
+    QByteArray spilledData = spillFile.readAll();
+    spillFile.close();
+
+    insertBuffer(remotePath, spilledData);
+    return spilledData;
+}
+
+void FileBufferCache::dropBuffer(RemotePath remotePath)
+{
+    auto memoryItr = memoryBuffers.find(remotePath);
+    if (memoryItr != memoryBuffers.end())
+    {
+        bytesInMemory -= memoryItr.value().data.size();
+        recentUseOrder.remove(memoryItr.value().useStamp);
+        memoryBuffers.erase(memoryItr);
+    }
+    if (spilledBuffers.contains(remotePath))
+    {
+        QFile::remove(spilledBuffers.take(remotePath));
+    }
+}
+
+qint64 FileBufferCache::getBytesInMemory()
+{
+    return bytesInMemory;
+}
+
+int FileBufferCache::getSpillCount()
+{
+    return spillCount;
+}
+
+void FileBufferCache::checkPendingNodes()
+{
+    qint64 timeNow = pendingClock.elapsed();
+    for (int i = pendingNodes.size() - 1; i >= 0; i--)
+    {
+        FileNodeRef aNode = pendingNodes.at(i).node;
+        if (aNode.isNil())
+        {
+            pendingNodes.removeAt(i);
+            continue;
+        }
+        if (!aNode.fileBufferLoaded())
+        {
+            if (timeNow - pendingNodes.at(i).requestTime > MAX_ADOPT_WAIT)
+            {
+                qCDebug(agaveAppLayer, "File buffer did not arrive in time: %s", qPrintable(aNode.getFullPath()));
+                pendingNodes.removeAt(i);
+            }
+            continue;
+        }
+
+        insertBuffer(RemotePath(aNode.getFullPath()), *(aNode.getFileBuffer()));
+        aNode.setFileBuffer(nullptr);
+        pendingNodes.removeAt(i);
+    }
+
+    if (pendingNodes.isEmpty())
+    {
+        pendingTimer.stop();
+    }
+}
+
+void FileBufferCache::fileOperationDone(RequestState opState)
+{
+    checkPendingNodes();
+    if ((opState == RequestState::GOOD) || pendingNodes.isEmpty()) return;
+
+    //Buffers which have not arrived by now belong to the failed request, and will not arrive
+    for (const PendingNode &aPending : pendingNodes)
+    {
+        if (aPending.node.isNil()) continue;
+        qCDebug(agaveAppLayer, "File buffer retrieve failed: %s", qPrintable(aPending.node.getFullPath()));
+    }
+    pendingNodes.clear();
+    pendingTimer.stop();
+}
+
+void FileBufferCache::markUsed(MemoryBuffer &theBuffer, RemotePath remotePath)
+{
+    recentUseOrder.remove(theBuffer.useStamp);
+    recentUseOrder.insert(nextUseStamp, remotePath);
+    theBuffer.useStamp = nextUseStamp++;
+}
+
+void FileBufferCache::evictToBudget()
+{
+    //The newest buffer is always kept, even if it alone is over budget
+    while ((bytesInMemory > myByteBudget) && (recentUseOrder.size() > 1))
+    {
+        RemotePath oldestPath = recentUseOrder.take(recentUseOrder.firstKey());
+        QByteArray oldestBuffer = memoryBuffers.take(oldestPath).data;
+        bytesInMemory -= oldestBuffer.size();
+
+        if (mySpillFolder.isEmpty()) continue;
+
+        QFile spillFile(spillFileName(oldestPath));
+        if (spillFile.open(QIODevice::WriteOnly | QIODevice::Truncate) && (spillFile.write(oldestBuffer) == oldestBuffer.size()))
+        {
+            spilledBuffers.insert(oldestPath, spillFile.fileName());
+            spillCount++;
+        }
+        else
+        {
+            qCDebug(agaveAppLayer, "Unable to spill file buffer to disk: %s", qPrintable(spillFile.fileName()));
+            spillFile.remove();
+        }
+    }
+}
+
+QString FileBufferCache::spillFileName(RemotePath remotePath)
+{
+    QByteArray pathHash = QCryptographicHash::hash(remotePath.toString().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QString("%1/%2.buf").arg(mySpillFolder, QString::fromLatin1(pathHash));
+}
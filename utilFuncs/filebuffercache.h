@@ -0,0 +1,120 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef FILEBUFFERCACHE_H
+#define FILEBUFFERCACHE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include "remoteFiles/filenoderef.h"
+#include "utilFuncs/remotepath.h"
+
+/*! \brief The FileBufferCache holds the contents of retrieved remote files, within a fixed memory budget.
+ *
+ *  Buffers are kept in memory in least-recently-used order. When the total size passes the budget, the oldest buffers are evicted.
+ *  If a spill folder is given, evicted buffers are written there, and are read back on demand. Otherwise, they are simply dropped and must be retrieved again.
+ *
+ *  Use adoptWhenLoaded() after requesting a file buffer: once the buffer arrives, it is moved out of the file tree and into the cache.
+ *  A retrieve which fails, according to the FileOperator, or which has not arrived after MAX_ADOPT_WAIT milliseconds, is given up.
+ */
+
+enum class RequestState;
+
+class FileOperator;
+
+class FileBufferCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileBufferCache(qint64 byteBudget, FileOperator * fileHandle, QString spillFolderName = QString(), QObject *parent = nullptr);
+    ~FileBufferCache();
+
+    void adoptWhenLoaded(FileNodeRef targetNode);
+
+    void insertBuffer(RemotePath remotePath, QByteArray newBuffer);
+    bool haveBuffer(RemotePath remotePath);
+    QByteArray getBuffer(RemotePath remotePath);
+    void dropBuffer(RemotePath remotePath);
+
+    qint64 getBytesInMemory();
+    int getSpillCount();
+
+private slots:
+    void checkPendingNodes();
+    void fileOperationDone(RequestState opState);
+
+private:
+    struct MemoryBuffer
+    {
+        QByteArray data;
+        quint64 useStamp;
+    };
+
+    struct PendingNode
+    {
+        FileNodeRef node;
+        qint64 requestTime;
+    };
+
+    void markUsed(MemoryBuffer &theBuffer, RemotePath remotePath);
+    void evictToBudget();
+    QString spillFileName(RemotePath remotePath);
+
+    static const qint64 MAX_ADOPT_WAIT = 5 * 60 * 1000;
+
+    qint64 myByteBudget;
+    QString mySpillFolder;
+
+    //Use stamps only increase, so the first entry of recentUseOrder is the least recently used
+    QHash<RemotePath, MemoryBuffer> memoryBuffers;
+    QMap<quint64, RemotePath> recentUseOrder;
+    quint64 nextUseStamp = 0;
+    QHash<RemotePath, QString> spilledBuffers;
+    qint64 bytesInMemory = 0;
+    int spillCount = 0;
+
+    QList<PendingNode> pendingNodes;
+    QTimer pendingTimer;
+    QElapsedTimer pendingClock;
+};
+
+#endif // FILEBUFFERCACHE_H
@@ -0,0 +1,246 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "folderprefetcher.h"
+
+#include "remoteFiles/remotefiletree.h"
+#include "remoteFiles/fileoperator.h"
+
+#include "ae_globals.h"
+
+static const int PREFETCH_TICK_MS = 250;
+static const int PREFETCH_TIMEOUT_MS = 10000;
+static const int RECENT_FOLDER_COUNT = 20;
+
+FolderPrefetcher::FolderPrefetcher(RemoteFileTree * theTree, QObject *parent) : QObject(parent)
+{
+    myTree = theTree;
+
+    myTree->setMouseTracking(true);
+    QObject::connect(myTree, SIGNAL(newFileSelected(FileNodeRef)), this, SLOT(fileSelected(FileNodeRef)));
+    QObject::connect(myTree, SIGNAL(entered(QModelIndex)), this, SLOT(entryHovered(QModelIndex)));
+    QObject::connect(myTree, SIGNAL(expanded(QModelIndex)), this, SLOT(folderExpanded(QModelIndex)));
+
+    budgetWindow.start();
+    QObject::connect(&tickTimer, SIGNAL(timeout()), this, SLOT(prefetchTick()));
+    tickTimer.start(PREFETCH_TICK_MS);
+}
+
+FolderPrefetcher::~FolderPrefetcher()
+{
+    qCDebug(agaveAppLayer, "Folder prefetch: %d prefetched, %d hits, %d misses", prefetchCount, hitCount, missCount);
+}
+
+void FolderPrefetcher::setBudget(int requestsPerMinute, int maxEntries)
+{
+    maxRequestsPerMinute = requestsPerMinute;
+    maxPrefetchEntries = maxEntries;
+}
+
+int FolderPrefetcher::getPrefetchCount()
+{
+    return prefetchCount;
+}
+
+int FolderPrefetcher::getHitCount()
+{
+    return hitCount;
+}
+
+int FolderPrefetcher::getMissCount()
+{
+    return missCount;
+}
+
+void FolderPrefetcher::fileSelected(FileNodeRef newSelection)
+{
+    if (newSelection.isNil()) return;
+    if (newSelection.getFileType() != FileType::DIR) return;
+
+    RemotePath selectedPath(newSelection.getFullPath());
+    recentFolders.removeAll(selectedPath);
+    recentFolders.prepend(selectedPath);
+    while (recentFolders.size() > RECENT_FOLDER_COUNT)
+    {
+        recentFolders.removeLast();
+    }
+
+    //The selected folder is the most likely to be opened next, then its sub-folders
+    addCandidate(newSelection, 3);
+    if (!newSelection.folderContentsLoaded()) return;
+
+    for (FileNodeRef aChild : newSelection.getChildList())
+    {
+        if (aChild.getFileType() != FileType::DIR) continue;
+
+        int childScore = 1;
+        if (recentFolders.contains(RemotePath(aChild.getFullPath())))
+        {
+            childScore = 2;
+        }
+        addCandidate(aChild, childScore);
+    }
+}
+
+void FolderPrefetcher::entryHovered(QModelIndex hoverIndex)
+{
+    RemotePath hoverPath = indexToPath(hoverIndex);
+    if (candidateScores.contains(hoverPath))
+    {
+        candidateScores[hoverPath] += 2;
+    }
+}
+
+void FolderPrefetcher::folderExpanded(QModelIndex expandedIndex)
+{
+    if (!expandedIndex.isValid()) return;
+    RemotePath expandedPath = indexToPath(expandedIndex);
+
+    //A prefetch still in flight when the folder is opened saved nothing, unless its listing arrived since the last tick
+    if (prefetchPending && (expandedPath == pendingPath))
+    {
+        FileNodeRef pendingNode = candidateNodes.value(pendingPath);
+        if (!pendingNode.isNil() && pendingNode.folderContentsLoaded())
+        {
+            prefetchedFolders.insert(pendingPath);
+        }
+    }
+
+    //Only the first expand after a prefetch is saved by it
+    if (prefetchedFolders.remove(expandedPath))
+    {
+        hitCount++;
+    }
+    else
+    {
+        missCount++;
+    }
+    qCDebug(agaveAppLayer, "Folder prefetch hit rate: %d of %d", hitCount, hitCount + missCount);
+}
+
+void FolderPrefetcher::prefetchTick()
+{
+    if (prefetchPending)
+    {
+        FileNodeRef pendingNode = candidateNodes.value(pendingPath);
+        if (!pendingNode.isNil() && pendingNode.folderContentsLoaded())
+        {
+            prefetchEntries += pendingNode.getChildList().size();
+            prefetchedFolders.insert(pendingPath);
+        }
+        else if (pendingTimer.elapsed() < PREFETCH_TIMEOUT_MS)
+        {
+            return;
+        }
+        candidateNodes.remove(pendingPath);
+        candidateScores.remove(pendingPath);
+        prefetchPending = false;
+    }
+
+    if (candidateScores.isEmpty()) return;
+
+    //Prefetch is the lowest priority, user operations always go first
+    FileOperator * fileHandle = ae_globals::get_file_handle();
+    if ((fileHandle == nullptr) || fileHandle->operationIsPending()) return;
+    if (!budgetAvailable()) return;
+
+    RemotePath bestPath;
+    int bestScore = 0;
+    for (auto itr = candidateScores.constBegin(); itr != candidateScores.constEnd(); itr++)
+    {
+        if (itr.value() > bestScore)
+        {
+            bestScore = itr.value();
+            bestPath = itr.key();
+        }
+    }
+
+    FileNodeRef bestNode = candidateNodes.value(bestPath);
+    if (bestNode.isNil() || bestNode.folderContentsLoaded())
+    {
+        candidateNodes.remove(bestPath);
+        candidateScores.remove(bestPath);
+        return;
+    }
+
+    bestNode.enactFolderRefresh();
+    prefetchCount++;
+    requestsInWindow++;
+
+    pendingPath = bestPath;
+    prefetchPending = true;
+    pendingTimer.start();
+}
+
+void FolderPrefetcher::addCandidate(FileNodeRef aNode, int score)
+{
+    RemotePath nodePath(aNode.getFullPath());
+    if (prefetchedFolders.contains(nodePath)) return;
+    if (prefetchPending && (nodePath == pendingPath)) return;
+    if (aNode.folderContentsLoaded()) return;
+
+    candidateNodes.insert(nodePath, aNode);
+    candidateScores.insert(nodePath, candidateScores.value(nodePath, 0) + score);
+}
+
+bool FolderPrefetcher::budgetAvailable()
+{
+    if (budgetWindow.elapsed() > 60000)
+    {
+        budgetWindow.restart();
+        requestsInWindow = 0;
+    }
+    if (requestsInWindow >= maxRequestsPerMinute) return false;
+    if (prefetchEntries >= maxPrefetchEntries) return false;
+    return true;
+}
+
+RemotePath FolderPrefetcher::indexToPath(QModelIndex anIndex)
+{
+    QList<QModelIndex> indexChain;
+    QModelIndex walkIndex = anIndex.sibling(anIndex.row(), 0);
+    while (walkIndex.isValid())
+    {
+        indexChain.prepend(walkIndex);
+        walkIndex = walkIndex.parent();
+    }
+
+    RemotePath indexPath;
+    for (const QModelIndex &anEntry : indexChain)
+    {
+        indexPath = indexPath.getChild(anEntry.data().toString());
+    }
+    return indexPath;
+}
@@ -0,0 +1,108 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef FOLDERPREFETCHER_H
+#define FOLDERPREFETCHER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QModelIndex>
+#include <QHash>
+#include <QSet>
+
+#include "remoteFiles/filenoderef.h"
+#include "utilFuncs/remotepath.h"
+
+class RemoteFileTree;
+
+/*! \brief The FolderPrefetcher loads the contents of folders in a RemoteFileTree before the user opens them.
+ *
+ *  Candidate folders are scored from what the user selects, hovers over, and has recently visited. At most one prefetch is outstanding at a time, and none is started while a user file operation is pending.
+ *  Prefetches are limited both in requests per minute, and in the total number of entries loaded by prefetch.
+ *
+ *  When the user expands a folder, it is counted as a hit if its prefetched listing had already arrived, and as a miss otherwise. Each prefetch gives at most one hit.
+ */
+
+class FolderPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FolderPrefetcher(RemoteFileTree * theTree, QObject *parent = nullptr);
+    ~FolderPrefetcher();
+
+    void setBudget(int requestsPerMinute, int maxEntries);
+
+    int getPrefetchCount();
+    int getHitCount();
+    int getMissCount();
+
+private slots:
+    void fileSelected(FileNodeRef newSelection);
+    void entryHovered(QModelIndex hoverIndex);
+    void folderExpanded(QModelIndex expandedIndex);
+    void prefetchTick();
+
+private:
+    void addCandidate(FileNodeRef aNode, int score);
+    bool budgetAvailable();
+
+    RemotePath indexToPath(QModelIndex anIndex);
+
+    RemoteFileTree * myTree;
+    QTimer tickTimer;
+
+    QHash<RemotePath, FileNodeRef> candidateNodes;
+    QHash<RemotePath, int> candidateScores;
+    QList<RemotePath> recentFolders;
+    QSet<RemotePath> prefetchedFolders;
+
+    bool prefetchPending = false;
+    RemotePath pendingPath;
+    QElapsedTimer pendingTimer;
+
+    QElapsedTimer budgetWindow;
+    int requestsInWindow = 0;
+    int maxRequestsPerMinute = 30;
+    int maxPrefetchEntries = 5000;
+    int prefetchEntries = 0;
+
+    int prefetchCount = 0;
+    int hitCount = 0;
+    int missCount = 0;
+};
+
+#endif // FOLDERPREFETCHER_H
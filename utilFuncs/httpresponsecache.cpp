@@ -0,0 +1,143 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+
+#include "httpresponsecache.h"
+
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegExp>
+
+HttpResponseCache::HttpResponseCache(QString cacheFolder, qint64 maxBytes, QObject *parent) : QNetworkDiskCache(parent)
+{
+    setCacheDirectory(cacheFolder);
+    setMaximumCacheSize(maxBytes);
+    clear();
+}
+
+QIODevice * HttpResponseCache::prepare(const QNetworkCacheMetaData &metaData)
+{
+    QIODevice * entryDevice = QNetworkDiskCache::prepare(expireNow(metaData));
+    if ((entryDevice != nullptr) && isJobDetailUrl(metaData.url()))
+    {
+        preparedJobEntries.insert(entryDevice, metaData.url());
+    }
+    return entryDevice;
+}
+
+void HttpResponseCache::updateMetaData(const QNetworkCacheMetaData &metaData)
+{
+    //A 304 reply refreshes the stored headers, which must not make the entry fresh either
+    QNetworkDiskCache::updateMetaData(expireNow(metaData));
+}
+
+void HttpResponseCache::insert(QIODevice *device)
+{
+    //The job state is read once, while the body is at hand, rather than from disk on every later request
+    if (preparedJobEntries.contains(device))
+    {
+        QUrl jobUrl = preparedJobEntries.take(device);
+        qint64 writePos = device->pos();
+        device->seek(0);
+        bool jobEnded = isTerminalJobReply(device->readAll());
+        device->seek(writePos);
+
+        if (jobEnded)
+        {
+            terminalJobs.insert(jobUrl);
+        }
+        else
+        {
+            terminalJobs.remove(jobUrl);
+        }
+    }
+    QNetworkDiskCache::insert(device);
+}
+
+bool HttpResponseCache::remove(const QUrl &url)
+{
+    terminalJobs.remove(url);
+    for (auto itr = preparedJobEntries.begin(); itr != preparedJobEntries.end();)
+    {
+        itr = (itr.value() == url) ? preparedJobEntries.erase(itr) : itr + 1;
+    }
+    return QNetworkDiskCache::remove(url);
+}
+
+void HttpResponseCache::clear()
+{
+    terminalJobs.clear();
+    preparedJobEntries.clear();
+    QNetworkDiskCache::clear();
+}
+
+bool HttpResponseCache::holdsTerminalJob(const QUrl &jobUrl)
+{
+    //An entry evicted from disk since is simply fetched again, as PreferCache falls back to the network
+    return terminalJobs.contains(jobUrl);
+}
+
+bool HttpResponseCache::isJobDetailUrl(const QUrl &theUrl)
+{
+    static const QRegExp jobDetailPath("^/jobs/v2/[^/]+/?$");
+    return jobDetailPath.exactMatch(theUrl.path());
+}
+
+bool HttpResponseCache::isTerminalJobReply(QByteArray replyBody)
+{
+    QJsonObject jobObject = QJsonDocument::fromJson(replyBody).object().value("result").toObject();
+    QString jobState = jobObject.value("status").toString();
+
+    //Jobs in these states are never updated again
+    return ((jobState == "FINISHED") || (jobState == "FAILED") || (jobState == "STOPPED"));
+}
+
+QNetworkCacheMetaData HttpResponseCache::expireNow(QNetworkCacheMetaData metaData)
+{
+    if (!metaData.isValid()) return metaData;
+
+    //Entries are only worth keeping if the server can confirm them later, or if they may turn out to be final
+    bool canRevalidate = metaData.lastModified().isValid() || isJobDetailUrl(metaData.url());
+    for (const QNetworkCacheMetaData::RawHeader &aHeader : metaData.rawHeaders())
+    {
+        if (aHeader.first.toLower() == "etag") canRevalidate = true;
+    }
+    if (!canRevalidate)
+    {
+        metaData.setSaveToDisk(false);
+    }
+
+    metaData.setExpirationDate(QDateTime::currentDateTimeUtc());
+    return metaData;
+}
@@ -0,0 +1,79 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+
+#ifndef HTTPRESPONSECACHE_H
+#define HTTPRESPONSECACHE_H
+
+#include <QNetworkDiskCache>
+#include <QUrl>
+#include <QHash>
+#include <QSet>
+
+/*! \brief The HttpResponseCache is a size-bounded disk cache of HTTP replies, which are revalidated with the server before each reuse.
+ *
+ *  Entries are stored with an expiry of the moment they arrive, so a cached reply is only reused after the server answers a conditional request (If-None-Match or If-Modified-Since) with 304 Not Modified.
+ *  Requests made with the PreferCache load control are the exception: they are served straight from the cache, with no round trip. This is meant for replies which can no longer change, such as the details of a job which has ended.
+ *
+ *  Job detail replies are checked for a final job state as they are stored, so that holdsTerminalJob() needs no disk access.
+ *
+ *  The cache is emptied when created, so that one user's replies are never served in a later session.
+ */
+
+class HttpResponseCache : public QNetworkDiskCache
+{
+    Q_OBJECT
+
+public:
+    explicit HttpResponseCache(QString cacheFolder, qint64 maxBytes, QObject *parent = nullptr);
+
+    virtual QIODevice * prepare(const QNetworkCacheMetaData &metaData);
+    virtual void updateMetaData(const QNetworkCacheMetaData &metaData);
+    virtual void insert(QIODevice *device);
+    virtual bool remove(const QUrl &url);
+
+    bool holdsTerminalJob(const QUrl &jobUrl);
+    static bool isJobDetailUrl(const QUrl &theUrl);
+
+public slots:
+    virtual void clear();
+
+private:
+    static QNetworkCacheMetaData expireNow(QNetworkCacheMetaData metaData);
+    static bool isTerminalJobReply(QByteArray replyBody);
+
+    QHash<QIODevice *, QUrl> preparedJobEntries;
+    QSet<QUrl> terminalJobs;
+};
+
+#endif // HTTPRESPONSECACHE_H
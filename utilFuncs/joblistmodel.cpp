@@ -0,0 +1,384 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "joblistmodel.h"
+
+#include <QSet>
+#include <algorithm>
+
+#include "remoteJobs/joboperator.h"
+#include "utilFuncs/stallwatchdog.h"
+
+static const int JOB_PAGE_SIZE = 100;
+static const int FRAME_INTERVAL_MS = 16;
+static const qint64 FRAME_BUDGET_MS = 8;
+static const int MERGE_CHECK_ROWS = 64;
+static const int SORT_RUN_ROWS = 256;
+
+JobListModel::JobListModel(JobOperator * theJobHandle, QObject *parent) : QAbstractTableModel(parent)
+{
+    myJobHandle = theJobHandle;
+    frameTimer.setSingleShot(true);
+    frameTimer.setInterval(FRAME_INTERVAL_MS);
+    QObject::connect(&frameTimer, SIGNAL(timeout()), this, SLOT(applyRefreshFrame()));
+
+    QObject::connect(myJobHandle, SIGNAL(newJobData()), this, SLOT(scheduleJobRefresh()));
+    scheduleJobRefresh();
+}
+
+int JobListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return visibleRows;
+}
+
+int JobListModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return 5;
+}
+
+QVariant JobListModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    if (!index.isValid() || (index.row() >= visibleRows)) return QVariant();
+
+    const RemoteJobData &theJob = jobRows.at(index.row());
+    switch (index.column())
+    {
+    case 0: return theJob.getName();
+    case 1: return theJob.getState();
+    case 2: return theJob.getApp();
+    case 3: return theJob.getTimeCreated();
+    case 4: return theJob.getID();
+    }
+    return QVariant();
+}
+
+QVariant JobListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ((role != Qt::DisplayRole) || (orientation != Qt::Horizontal)) return QVariant();
+
+    switch (section)
+    {
+    case 0: return QString("Task Name");
+    case 1: return QString("State");
+    case 2: return QString("Agave App");
+    case 3: return QString("Time Created");
+    case 4: return QString("Agave ID");
+    }
+    return QVariant();
+}
+
+bool JobListModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return false;
+    return visibleRows < jobRows.size();
+}
+
+void JobListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) return;
+
+    int newRows = qMin(JOB_PAGE_SIZE, jobRows.size() - visibleRows);
+    if (newRows <= 0) return;
+
+    beginInsertRows(QModelIndex(), visibleRows, visibleRows + newRows - 1);
+    visibleRows += newRows;
+    endInsertRows();
+}
+
+RemoteJobData JobListModel::getJobAtRow(int row)
+{
+    if ((row < 0) || (row >= visibleRows)) return RemoteJobData();
+    return jobRows.at(row);
+}
+
+RemoteJobData JobListModel::getJobWithID(QString jobID)
+{
+    for (const RemoteJobData &aJob : jobRows)
+    {
+        if (aJob.getID() == jobID) return aJob;
+    }
+    return RemoteJobData();
+}
+
+void JobListModel::scheduleJobRefresh()
+{
+    refreshPending = true;
+    if (!frameTimer.isActive()) frameTimer.start();
+}
+
+void JobListModel::applyRefreshFrame()
+{
+    StallWatchdog::HandlerMark mark("JobListModel::applyRefreshFrame");
+
+    QElapsedTimer frameClock;
+    frameClock.start();
+
+    //A refresh arriving during a merge restarts it from the newer data, since the rows are consistent between frames
+    if (refreshPending)
+    {
+        refreshPending = false;
+        startJobSnapshot();
+    }
+    if (refreshPhase == RefreshPhase::IDLE) return;
+
+    if (!continueRefresh(frameClock))
+    {
+        frameTimer.start();
+        return;
+    }
+
+    pendingJobs.clear();
+    currentIDs.clear();
+    if (visibleRows == 0)
+    {
+        fetchMore(QModelIndex());
+    }
+    emit jobListUpdated();
+}
+
+void JobListModel::startJobSnapshot()
+{
+    snapshotMap = myJobHandle->getJobsList();
+    snapshotItr = snapshotMap.constBegin();
+
+    pendingJobs.clear();
+    pendingJobs.reserve(snapshotMap.size());
+    newIDs.clear();
+    newIDs.reserve(snapshotMap.size());
+    refreshPhase = RefreshPhase::COPY;
+}
+
+bool JobListModel::continueRefresh(const QElapsedTimer &frameClock)
+{
+    if ((refreshPhase == RefreshPhase::COPY) && !copyJobSnapshot(frameClock)) return false;
+    if ((refreshPhase == RefreshPhase::SORT) && !sortJobSnapshot(frameClock)) return false;
+    if ((refreshPhase == RefreshPhase::REMOVE) && !removeGoneRows(frameClock)) return false;
+    if ((refreshPhase == RefreshPhase::MERGE) && !mergeJobRows(frameClock)) return false;
+
+    refreshPhase = RefreshPhase::IDLE;
+    return true;
+}
+
+bool JobListModel::copyJobSnapshot(const QElapsedTimer &frameClock)
+{
+    //Each run of copied jobs is sorted on its own, and the runs are merged afterwards
+    while (snapshotItr != snapshotMap.constEnd())
+    {
+        if (frameClock.elapsed() >= FRAME_BUDGET_MS) return false;
+
+        int runStart = pendingJobs.size();
+        while ((snapshotItr != snapshotMap.constEnd()) && (pendingJobs.size() - runStart < SORT_RUN_ROWS))
+        {
+            if ((*snapshotItr) != nullptr)
+            {
+                pendingJobs.append(*(*snapshotItr));
+                newIDs.insert(pendingJobs.last().getID());
+            }
+            snapshotItr++;
+        }
+        std::stable_sort(pendingJobs.begin() + runStart, pendingJobs.end(), newerJobFirst);
+    }
+
+    snapshotMap.clear();
+    sortWidth = SORT_RUN_ROWS;
+    sortStart = 0;
+    refreshPhase = RefreshPhase::SORT;
+    return true;
+}
+
+bool JobListModel::sortJobSnapshot(const QElapsedTimer &frameClock)
+{
+    //Bottom-up merge of the sorted runs, which is stable like the sort of each run
+    while (sortWidth < pendingJobs.size())
+    {
+        while (sortStart + sortWidth < pendingJobs.size())
+        {
+            if (frameClock.elapsed() >= FRAME_BUDGET_MS) return false;
+
+            int midRow = sortStart + sortWidth;
+            int endRow = qMin(pendingJobs.size(), midRow + sortWidth);
+            std::inplace_merge(pendingJobs.begin() + sortStart, pendingJobs.begin() + midRow, pendingJobs.begin() + endRow, newerJobFirst);
+            sortStart = endRow;
+        }
+        sortStart = 0;
+        sortWidth *= 2;
+    }
+
+    removeRow = jobRows.size() - 1;
+    removeSpanEnd = -1;
+    currentIDs.clear();
+    currentIDs.reserve(jobRows.size());
+    refreshPhase = RefreshPhase::REMOVE;
+    return true;
+}
+
+bool JobListModel::removeGoneRows(const QElapsedTimer &frameClock)
+{
+    //Rows for jobs which are gone are removed as spans of neighboring rows, from the end, so earlier row numbers stay valid
+    while (removeRow >= 0)
+    {
+        if (frameClock.elapsed() >= FRAME_BUDGET_MS) return false;
+
+        int stopRow = qMax(-1, removeRow - MERGE_CHECK_ROWS);
+        for ( ; removeRow > stopRow; removeRow--)
+        {
+            QString jobID = jobRows.at(removeRow).getID();
+            bool isGone = !newIDs.contains(jobID);
+            if (!isGone) currentIDs.insert(jobID);
+
+            if (isGone && (removeSpanEnd < 0)) removeSpanEnd = removeRow;
+            if (!isGone && (removeSpanEnd >= 0))
+            {
+                removeJobRows(removeRow + 1, removeSpanEnd);
+                removeSpanEnd = -1;
+            }
+        }
+    }
+    if (removeSpanEnd >= 0) removeJobRows(0, removeSpanEnd);
+    removeSpanEnd = -1;
+
+    newIDs.clear();
+    jobRows.reserve(pendingJobs.size());
+    mergeRow = 0;
+    refreshPhase = RefreshPhase::MERGE;
+    return true;
+}
+
+bool JobListModel::mergeJobRows(const QElapsedTimer &frameClock)
+{
+    //Remaining rows are in the same order as the new list, so new jobs can be merged in
+    while (mergeRow < pendingJobs.size())
+    {
+        if (frameClock.elapsed() >= FRAME_BUDGET_MS) return false;
+
+        int stopRow = qMin(pendingJobs.size(), mergeRow + MERGE_CHECK_ROWS);
+        while (mergeRow < stopRow)
+        {
+            const RemoteJobData &newJob = pendingJobs.at(mergeRow);
+
+            if ((mergeRow < jobRows.size()) && (jobRows.at(mergeRow).getID() == newJob.getID()))
+            {
+                if (jobEntryDiffers(jobRows.at(mergeRow), newJob))
+                {
+                    bool stateChanged = (jobRows.at(mergeRow).getState() != newJob.getState());
+                    jobRows[mergeRow] = newJob;
+                    if (stateChanged)
+                    {
+                        emit jobStateChanged(newJob);
+                    }
+                    if (mergeRow < visibleRows)
+                    {
+                        emit dataChanged(index(mergeRow, 0), index(mergeRow, columnCount() - 1));
+                    }
+                }
+                mergeRow++;
+                continue;
+            }
+
+            //Jobs not yet in the list are gathered into one span, which ends at the frame budget
+            QList<RemoteJobData> newSpan;
+            newSpan.append(newJob);
+            int nextRow = mergeRow + 1;
+            while ((nextRow < pendingJobs.size()) && !currentIDs.contains(pendingJobs.at(nextRow).getID()))
+            {
+                if ((newSpan.size() % MERGE_CHECK_ROWS == 0) && (frameClock.elapsed() >= FRAME_BUDGET_MS)) break;
+
+                newSpan.append(pendingJobs.at(nextRow));
+                nextRow++;
+            }
+            insertJobRows(mergeRow, newSpan);
+            mergeRow += newSpan.size();
+        }
+    }
+
+    //Truncate anything left over, in case the ordering did change
+    if (jobRows.size() > pendingJobs.size())
+    {
+        removeJobRows(pendingJobs.size(), jobRows.size() - 1);
+    }
+    return true;
+}
+
+void JobListModel::removeJobRows(int firstRow, int lastRow)
+{
+    int lastVisible = qMin(lastRow, visibleRows - 1);
+    if (firstRow <= lastVisible)
+    {
+        beginRemoveRows(QModelIndex(), firstRow, lastVisible);
+        jobRows.erase(jobRows.begin() + firstRow, jobRows.begin() + lastRow + 1);
+        visibleRows -= lastVisible - firstRow + 1;
+        endRemoveRows();
+        return;
+    }
+    jobRows.erase(jobRows.begin() + firstRow, jobRows.begin() + lastRow + 1);
+}
+
+void JobListModel::insertJobRows(int row, const QList<RemoteJobData> &newJobs)
+{
+    //New jobs among the visible rows are shown right away, as is the first page
+    int shownRows = 0;
+    if (row < visibleRows)
+    {
+        shownRows = newJobs.size();
+    }
+    else if ((row == visibleRows) && (visibleRows < JOB_PAGE_SIZE))
+    {
+        shownRows = qMin(newJobs.size(), JOB_PAGE_SIZE - visibleRows);
+    }
+
+    if (shownRows > 0) beginInsertRows(QModelIndex(), row, row + shownRows - 1);
+    for (int i = 0; i < newJobs.size(); i++)
+    {
+        jobRows.insert(row + i, newJobs.at(i));
+    }
+    visibleRows += shownRows;
+    if (shownRows > 0) endInsertRows();
+}
+
+bool JobListModel::newerJobFirst(const RemoteJobData &job1, const RemoteJobData &job2)
+{
+    return job1.getTimeCreated() > job2.getTimeCreated();
+}
+
+bool JobListModel::jobEntryDiffers(const RemoteJobData &job1, const RemoteJobData &job2)
+{
+    if (job1.getState() != job2.getState()) return true;
+    if (job1.getName() != job2.getName()) return true;
+    if (job1.getApp() != job2.getApp()) return true;
+    return false;
+}
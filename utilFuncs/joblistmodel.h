@@ -0,0 +1,125 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef JOBLISTMODEL_H
+#define JOBLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "remotejobdata.h"
+
+class JobOperator;
+
+/*! \brief The JobListModel is a table model of remote jobs, which is updated in place as job data is refreshed.
+ *
+ *  On each refresh, the new job list is compared against the current rows by job ID. Only the rows which were added, removed or changed are signaled to the view, so that the view keeps its scroll position and selection.
+ *
+ *  jobStateChanged() is emitted for each known job whose state changes in a refresh.
+ *
+ *  Rows are handed to the view in pages, as the user scrolls, using the canFetchMore()/fetchMore() mechanism of Qt item views.
+ *
+ *  Job data arrives from the remote interface thread in bursts. Refreshes are held until the next frame, so a burst is applied once.
+ *  Neighboring added or removed rows are signaled as one span, cut short where it would pass the frame budget.
+ *  Every stage of a refresh (copying the job list, sorting it, removing gone rows and merging new ones) stops at the frame budget and is continued in the next frame, so a large job list does not stall the GUI.
+ */
+
+class JobListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit JobListModel(JobOperator * theJobHandle, QObject *parent = nullptr);
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    virtual bool canFetchMore(const QModelIndex &parent) const;
+    virtual void fetchMore(const QModelIndex &parent);
+
+    RemoteJobData getJobAtRow(int row);
+    RemoteJobData getJobWithID(QString jobID);
+
+signals:
+    void jobListUpdated();
+    void jobStateChanged(RemoteJobData changedJob);
+
+private slots:
+    void scheduleJobRefresh();
+    void applyRefreshFrame();
+
+private:
+    enum class RefreshPhase {IDLE, COPY, SORT, REMOVE, MERGE};
+
+    void startJobSnapshot();
+    bool continueRefresh(const QElapsedTimer &frameClock);
+    bool copyJobSnapshot(const QElapsedTimer &frameClock);
+    bool sortJobSnapshot(const QElapsedTimer &frameClock);
+    bool removeGoneRows(const QElapsedTimer &frameClock);
+    bool mergeJobRows(const QElapsedTimer &frameClock);
+    void removeJobRows(int firstRow, int lastRow);
+    void insertJobRows(int row, const QList<RemoteJobData> &newJobs);
+    static bool jobEntryDiffers(const RemoteJobData &job1, const RemoteJobData &job2);
+    static bool newerJobFirst(const RemoteJobData &job1, const RemoteJobData &job2);
+
+    JobOperator * myJobHandle;
+
+    QList<RemoteJobData> jobRows;
+    int visibleRows = 0;
+
+    QTimer frameTimer;
+    bool refreshPending = false;
+    RefreshPhase refreshPhase = RefreshPhase::IDLE;
+
+    //The job operator's entries are only read before the next refresh signal, which restarts the snapshot
+    QMap<QString, const RemoteJobData *> snapshotMap;
+    QMap<QString, const RemoteJobData *>::const_iterator snapshotItr;
+    QList<RemoteJobData> pendingJobs;
+    QSet<QString> newIDs;
+    QSet<QString> currentIDs;
+    int sortWidth = 0;
+    int sortStart = 0;
+    int removeRow = -1;
+    int removeSpanEnd = -1;
+    int mergeRow = 0;
+};
+
+#endif // JOBLISTMODEL_H
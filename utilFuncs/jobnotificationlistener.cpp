@@ -0,0 +1,254 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "jobnotificationlistener.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUuid>
+
+#include "utilFuncs/agavesetupdriver.h"
+#include "utilFuncs/servicerequest.h"
+#include "ae_globals.h"
+
+static const int CALLBACK_MAX_SIZE = 64 * 1024;
+static const QStringList JOB_END_EVENTS = {"FINISHED", "FAILED", "STOPPED"};
+
+JobNotificationListener::JobNotificationListener(QString callbackHost, QString bindAddress, quint16 port, QObject *parent) : QObject(parent)
+{
+    myCallbackHost = callbackHost;
+
+    QHostAddress listenAddress(bindAddress.isEmpty() ? callbackHost : bindAddress);
+    if (listenAddress.isNull())
+    {
+        listenAddress = QHostAddress::LocalHost;
+    }
+
+    QObject::connect(&callbackServer, SIGNAL(newConnection()), this, SLOT(newCallbackConnection()));
+    if (!callbackServer.listen(listenAddress, port))
+    {
+        qCDebug(agaveAppLayer, "Unable to listen for job notifications: %s", qPrintable(callbackServer.errorString()));
+        return;
+    }
+    qCDebug(agaveAppLayer, "Listening for job notifications on %s, at: %s", qPrintable(listenAddress.toString()), qPrintable(getCallbackBase()));
+}
+
+JobNotificationListener::~JobNotificationListener()
+{
+    callbackServer.close();
+}
+
+bool JobNotificationListener::isListening()
+{
+    return callbackServer.isListening();
+}
+
+QString JobNotificationListener::getCallbackBase()
+{
+    return QString("http://%1:%2").arg(myCallbackHost).arg(callbackServer.serverPort());
+}
+
+void JobNotificationListener::registerJob(QString jobID)
+{
+    if (!isListening() || jobID.isEmpty() || registeredJobs.contains(jobID)) return;
+
+    JobRegistration newRegistration;
+    newRegistration.secret = QString::fromLatin1(QUuid::createUuid().toRfc4122().toHex());
+    registeredJobs.insert(jobID, newRegistration);
+
+    //Agave fills in the job ID and event name when making the callback
+    for (QString anEvent : JOB_END_EVENTS)
+    {
+        QJsonObject notificationSpec;
+        notificationSpec.insert("associatedUuid", jobID);
+        notificationSpec.insert("event", anEvent);
+        notificationSpec.insert("persistent", false);
+        notificationSpec.insert("url", QString("%1/jobs/${JOB_ID}/${EVENT}/%2").arg(getCallbackBase(), newRegistration.secret));
+
+        ServiceRequest * registerRequest = new ServiceRequest(ae_globals::get_Driver()->getNetManager(), QNetworkAccessManager::PostOperation, "/notifications/v2");
+        registerRequest->setBody(QJsonDocument(notificationSpec).toJson(QJsonDocument::Compact), "application/json");
+        registerRequest->setProperty("jobID", jobID);
+        QObject::connect(registerRequest, SIGNAL(finished()), this, SLOT(registerReply()));
+        registerRequest->start();
+    }
+}
+
+int JobNotificationListener::getCallbackCount()
+{
+    return callbackCount;
+}
+
+void JobNotificationListener::newCallbackConnection()
+{
+    while (callbackServer.hasPendingConnections())
+    {
+        QTcpSocket * newSocket = callbackServer.nextPendingConnection();
+        partialRequests.insert(newSocket, QByteArray());
+
+        QObject::connect(newSocket, SIGNAL(readyRead()), this, SLOT(callbackDataReady()));
+        QObject::connect(newSocket, SIGNAL(disconnected()), this, SLOT(callbackDisconnected()));
+    }
+}
+
+void JobNotificationListener::callbackDataReady()
+{
+    QTcpSocket * theSocket = qobject_cast<QTcpSocket *>(sender());
+    if ((theSocket == nullptr) || !partialRequests.contains(theSocket)) return;
+
+    QByteArray &requestData = partialRequests[theSocket];
+    requestData.append(theSocket->readAll());
+
+    if (requestData.size() > CALLBACK_MAX_SIZE)
+    {
+        theSocket->write("HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    else if (!processRequest(theSocket, requestData))
+    {
+        return;
+    }
+
+    partialRequests.remove(theSocket);
+    theSocket->disconnectFromHost();
+}
+
+void JobNotificationListener::callbackDisconnected()
+{
+    QTcpSocket * theSocket = qobject_cast<QTcpSocket *>(sender());
+    if (theSocket == nullptr) return;
+
+    partialRequests.remove(theSocket);
+    theSocket->deleteLater();
+}
+
+void JobNotificationListener::registerReply()
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (theReply == nullptr) return;
+    theReply->deleteLater();
+
+    QString jobID = theReply->property("jobID").toString();
+    if (theReply->error() != QNetworkReply::NoError)
+    {
+        qCDebug(agaveAppLayer, "Unable to register job notification for %s: %s", qPrintable(jobID), qPrintable(theReply->errorString()));
+        return;
+    }
+
+    QString notificationID = QJsonDocument::fromJson(theReply->readAll()).object().value("result").toObject().value("id").toString();
+    if (notificationID.isEmpty()) return;
+
+    //The job may already have ended, in which case this notification is no longer needed
+    if (!registeredJobs.contains(jobID))
+    {
+        ServiceRequest * removeRequest = new ServiceRequest(ae_globals::get_Driver()->getNetManager(), QNetworkAccessManager::DeleteOperation,
+                                                            QString("/notifications/v2/%1").arg(notificationID));
+        QObject::connect(removeRequest, SIGNAL(finished()), this, SLOT(removeReply()));
+        removeRequest->start();
+        return;
+    }
+    registeredJobs[jobID].notificationIDs.append(notificationID);
+    qCDebug(agaveAppLayer, "Registered job notification for %s", qPrintable(jobID));
+}
+
+void JobNotificationListener::removeReply()
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (theReply == nullptr) return;
+    theReply->deleteLater();
+
+    if (theReply->error() != QNetworkReply::NoError)
+    {
+        qCDebug(agaveAppLayer, "Unable to remove job notification %s: %s", qPrintable(theReply->getServicePath()), qPrintable(theReply->errorString()));
+    }
+}
+
+void JobNotificationListener::removeRegistration(QString jobID)
+{
+    //The notification which was sent has already been removed by Agave, so removing it again just fails quietly
+    for (QString notificationID : registeredJobs.take(jobID).notificationIDs)
+    {
+        ServiceRequest * removeRequest = new ServiceRequest(ae_globals::get_Driver()->getNetManager(), QNetworkAccessManager::DeleteOperation,
+                                                            QString("/notifications/v2/%1").arg(notificationID));
+        QObject::connect(removeRequest, SIGNAL(finished()), this, SLOT(removeReply()));
+        removeRequest->start();
+    }
+}
+
+bool JobNotificationListener::processRequest(QTcpSocket * theSocket, QByteArray requestData)
+{
+    int headerEnd = requestData.indexOf("\r\n\r\n");
+    if (headerEnd < 0) return false;
+
+    QList<QByteArray> headerLines = requestData.left(headerEnd).split('\n');
+    int contentLength = 0;
+    for (QByteArray aLine : headerLines)
+    {
+        if (aLine.toLower().startsWith("content-length:"))
+        {
+            contentLength = aLine.mid(15).trimmed().toInt();
+        }
+    }
+    QByteArray requestBody = requestData.mid(headerEnd + 4);
+    if (requestBody.size() < contentLength) return false;
+
+    QList<QByteArray> requestLine = headerLines.first().trimmed().split(' ');
+    QString requestPath;
+    if (requestLine.size() >= 2)
+    {
+        requestPath = QUrl(QString::fromLatin1(requestLine.at(1))).path();
+    }
+
+    //Only a job registered here, with its own secret, is accepted
+    QStringList pathParts = requestPath.split('/', QString::SkipEmptyParts);
+    if ((pathParts.size() != 4) || (pathParts.at(0) != "jobs") || !registeredJobs.contains(pathParts.at(1))
+            || (registeredJobs.value(pathParts.at(1)).secret != pathParts.at(3)))
+    {
+        qCDebug(agaveAppLayer, "Ignored job notification request: %s", qPrintable(requestPath.section('/', 0, 3)));
+        theSocket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return true;
+    }
+    QString jobID = pathParts.at(1);
+    QString jobStatus = pathParts.at(2);
+
+    theSocket->write("HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    callbackCount++;
+    qCDebug(agaveAppLayer, "Job notification: %s is %s", qPrintable(jobID), qPrintable(jobStatus));
+
+    if (JOB_END_EVENTS.contains(jobStatus))
+    {
+        removeRegistration(jobID);
+    }
+    emit jobStatusReceived(jobID, jobStatus);
+    return true;
+}
@@ -0,0 +1,99 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef JOBNOTIFICATIONLISTENER_H
+#define JOBNOTIFICATIONLISTENER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QHash>
+
+class ServiceRequest;
+
+/*! \brief The JobNotificationListener is a small embedded HTTP server, which receives job status callbacks from Agave.
+ *
+ *  The server listens only on the bind address given at construction. If none is given, it listens on the callback host if that is an IP address, and on localhost otherwise.
+ *
+ *  registerJob() asks Agave to send callbacks for a job to this listener, at the callback host given at construction. The callback host must be reachable from the Agave server.
+ *  Callbacks are only asked for the events which end a job. Each is a one-time notification, which Agave removes once it has been sent. When one arrives, the others for that job are removed.
+ *  Each job is given a random secret, which is part of its callback URL: /jobs/<jobId>/<status>/<secret>. Any other request is answered with 404, and ignored.
+ *  Accepted callbacks are answered with 200 OK, and reported with the jobStatusReceived() signal.
+ */
+
+class JobNotificationListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobNotificationListener(QString callbackHost, QString bindAddress, quint16 port, QObject *parent = nullptr);
+    ~JobNotificationListener();
+
+    bool isListening();
+    QString getCallbackBase();
+    void registerJob(QString jobID);
+
+    int getCallbackCount();
+
+signals:
+    void jobStatusReceived(QString jobID, QString jobStatus);
+
+private slots:
+    void newCallbackConnection();
+    void callbackDataReady();
+    void callbackDisconnected();
+    void registerReply();
+    void removeReply();
+
+private:
+    struct JobRegistration
+    {
+        QString secret;
+        QStringList notificationIDs;
+    };
+
+    bool processRequest(QTcpSocket * theSocket, QByteArray requestData);
+    void removeRegistration(QString jobID);
+
+    QTcpServer callbackServer;
+    QString myCallbackHost;
+
+    QHash<QTcpSocket *, QByteArray> partialRequests;
+    QHash<QString, JobRegistration> registeredJobs;
+    int callbackCount = 0;
+};
+
+#endif // JOBNOTIFICATIONLISTENER_H
@@ -0,0 +1,355 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "joboutputharvester.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegExp>
+
+#include "utilFuncs/agavesetupdriver.h"
+#include "utilFuncs/servicerequest.h"
+#include "utilFuncs/diskwriterpool.h"
+#include "ae_globals.h"
+
+static const int HARVEST_PARALLEL_DOWNLOADS = 4;
+static const qint64 HARVEST_READ_BUFFER = 4 * 1024 * 1024;
+
+JobOutputHarvester::JobOutputHarvester(QString settingsGroup, QObject *parent) : QObject(parent)
+{
+    mySettingsGroup = settingsGroup;
+
+    myWriterPool = ae_globals::get_Driver()->getDiskWriter();
+    QObject::connect(myWriterPool, SIGNAL(fileClosed(int,bool,qint64,QString)), this, SLOT(fileWriteClosed(int,bool,qint64,QString)));
+    QObject::connect(myWriterPool, SIGNAL(writerDrained()), this, SLOT(writerDrained()));
+
+    QSettings ruleSettings("SimCenter", mySettingsGroup);
+    ruleSettings.beginGroup("harvestRules");
+    for (QString appName : ruleSettings.childKeys())
+    {
+        harvestRules.insert(appName, ruleSettings.value(appName).toString());
+    }
+    ruleSettings.endGroup();
+}
+
+void JobOutputHarvester::setHarvestRule(QString appName, QString rule)
+{
+    QSettings ruleSettings("SimCenter", mySettingsGroup);
+    ruleSettings.beginGroup("harvestRules");
+    if (rule.trimmed().isEmpty())
+    {
+        harvestRules.remove(appName);
+        ruleSettings.remove(appName);
+    }
+    else
+    {
+        harvestRules.insert(appName, rule);
+        ruleSettings.setValue(appName, rule);
+    }
+    ruleSettings.endGroup();
+}
+
+QString JobOutputHarvester::getHarvestRule(QString appName)
+{
+    return harvestRules.value(appName);
+}
+
+void JobOutputHarvester::jobFinished(RemoteJobData finishedJob)
+{
+    //App IDs carry a version suffix, such as cwe-serial-0.2.0, which rules leave off
+    QString appName = finishedJob.getApp();
+    appName.remove(QRegExp("-\\d+(\\.\\d+)*(u\\d+)?$"));
+    if (!harvestRules.contains(appName)) return;
+
+    QStringList ruleParts = harvestRules.value(appName).split("->");
+    if (ruleParts.size() != 2)
+    {
+        qCDebug(agaveAppLayer, "Invalid harvest rule for %s", qPrintable(appName));
+        return;
+    }
+    if (activeHarvests.contains(finishedJob.getID())) return;
+
+    QString remotePattern = ruleParts.at(0).trimmed();
+    QString localFolder = ruleParts.at(1).trimmed();
+    localFolder.replace("<jobId>", finishedJob.getID());
+    if (localFolder.startsWith("~"))
+    {
+        localFolder.replace(0, 1, QDir::homePath());
+    }
+
+    HarvestTask * newTask = new HarvestTask();
+    newTask->jobID = finishedJob.getID();
+    newTask->localFolder = localFolder;
+    newTask->remoteFolder = remotePattern.section('/', 0, -2);
+    newTask->fileFilter = remotePattern.section('/', -1);
+    newTask->harvestTimer.start();
+    activeHarvests.insert(newTask->jobID, newTask);
+
+    if (!QDir().mkpath(newTask->localFolder))
+    {
+        qCDebug(agaveAppLayer, "Unable to create harvest folder: %s", qPrintable(newTask->localFolder));
+        finishHarvest(newTask);
+        return;
+    }
+
+    qCDebug(agaveAppLayer, "Harvesting outputs of job %s", qPrintable(newTask->jobID));
+    ServiceRequest * listReply = new ServiceRequest(ae_globals::get_Driver()->getNetManager(), QNetworkAccessManager::GetOperation,
+                                                    QString("/jobs/v2/%1/outputs/listings/%2").arg(newTask->jobID, newTask->remoteFolder));
+    listReply->setProperty("jobID", newTask->jobID);
+    QObject::connect(listReply, SIGNAL(readyRead()), this, SLOT(listingDataReady()));
+    QObject::connect(listReply, SIGNAL(finished()), this, SLOT(listingReply()));
+    listReply->start();
+}
+
+void JobOutputHarvester::listingDataReady()
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (theReply == nullptr) return;
+
+    HarvestTask * theTask = activeHarvests.value(theReply->property("jobID").toString(), nullptr);
+    if (theTask == nullptr) return;
+
+    //Error replies are not listings, and are handled when the reply finishes
+    if (theReply->error() != QNetworkReply::NoError) return;
+
+    theTask->listParser.addData(theReply->readAll());
+    takeListedFiles(theTask);
+}
+
+void JobOutputHarvester::listingReply()
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (theReply == nullptr) return;
+    theReply->deleteLater();
+
+    HarvestTask * theTask = activeHarvests.value(theReply->property("jobID").toString(), nullptr);
+    if (theTask == nullptr) return;
+
+    theTask->listingDone = true;
+    if (theReply->error() != QNetworkReply::NoError)
+    {
+        qCDebug(agaveAppLayer, "Unable to list outputs of job %s: %s", qPrintable(theTask->jobID), qPrintable(theReply->errorString()));
+        theTask->waitingFiles.clear();
+        startDownloads(theTask);
+        return;
+    }
+
+    theTask->listParser.addData(theReply->readAll());
+    if (!theTask->listParser.resultComplete())
+    {
+        qCDebug(agaveAppLayer, "Incomplete output listing for job %s", qPrintable(theTask->jobID));
+    }
+    takeListedFiles(theTask);
+}
+
+void JobOutputHarvester::takeListedFiles(HarvestTask * theTask)
+{
+    QRegExp fileFilter(theTask->fileFilter, Qt::CaseSensitive, QRegExp::Wildcard);
+    while (theTask->listParser.hasEntry())
+    {
+        QJsonObject entryObject = theTask->listParser.takeEntry();
+        if (entryObject.value("type").toString() == "dir") continue;
+
+        QString fileName = entryObject.value("name").toString();
+        if (fileFilter.exactMatch(fileName))
+        {
+            theTask->waitingFiles.append(fileName);
+            theTask->expectedSizes.insert(fileName, (qint64) entryObject.value("length").toDouble());
+            if (entryObject.contains("checksum") && !entryObject.value("checksum").toString().isEmpty())
+            {
+                theTask->serverChecksums.insert(fileName, entryObject.value("checksum").toString());
+            }
+        }
+    }
+    startDownloads(theTask);
+}
+
+void JobOutputHarvester::downloadDataReady()
+{
+    //While the writers are behind, data is left in the reply, whose buffer limit then holds back the connection
+    if (myWriterPool->isBackedUp()) return;
+
+    readDownloadData(qobject_cast<ServiceRequest *>(sender()));
+}
+
+void JobOutputHarvester::downloadReply()
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (theReply == nullptr) return;
+    theReply->deleteLater();
+
+    if (!downloadWrites.contains(theReply)) return;
+    readDownloadData(theReply);
+
+    int fileID = downloadWrites.take(theReply);
+    StreamChecksum * theChecksum = downloadChecksums.take(theReply);
+
+    ClosingFile closingFile;
+    closingFile.jobID = theReply->property("jobID").toString();
+    closingFile.fileName = theReply->property("fileName").toString();
+    closingFile.checksum = theChecksum->getResult();
+    delete theChecksum;
+
+    HarvestTask * theTask = activeHarvests.value(closingFile.jobID, nullptr);
+    QString serverChecksum = (theTask == nullptr) ? QString() : theTask->serverChecksums.value(closingFile.fileName);
+
+    if (theReply->error() != QNetworkReply::NoError)
+    {
+        closingFile.failure = theReply->errorString();
+    }
+    else if (!serverChecksum.isEmpty() && !StreamChecksum::resultsMatch(serverChecksum, closingFile.checksum))
+    {
+        closingFile.failure = "Does not match server checksum";
+    }
+
+    //The download counts as active until the writer has finished with it
+    closingFiles.insert(fileID, closingFile);
+    if (closingFile.failure.isEmpty())
+    {
+        myWriterPool->closeFile(fileID);
+    }
+    else
+    {
+        myWriterPool->discardFile(fileID);
+    }
+}
+
+void JobOutputHarvester::fileWriteClosed(int fileID, bool succeeded, qint64 bytesWritten, QString errorText)
+{
+    if (!closingFiles.contains(fileID)) return;
+    ClosingFile closedFile = closingFiles.take(fileID);
+
+    HarvestTask * theTask = activeHarvests.value(closedFile.jobID, nullptr);
+    if (theTask == nullptr) return;
+    theTask->activeDownloads--;
+
+    if (!closedFile.failure.isEmpty() || !succeeded)
+    {
+        QString failureText = closedFile.failure.isEmpty() ? errorText : closedFile.failure;
+        qCDebug(agaveAppLayer, "Harvest of %s failed: %s", qPrintable(closedFile.fileName), qPrintable(failureText));
+        theTask->filesFailed++;
+    }
+    else
+    {
+        theTask->filesDone++;
+        theTask->bytesDone += bytesWritten;
+        theTask->fileChecksums.insert(closedFile.fileName, closedFile.checksum);
+    }
+
+    startDownloads(theTask);
+}
+
+void JobOutputHarvester::writerDrained()
+{
+    for (ServiceRequest * aReply : downloadWrites.keys())
+    {
+        readDownloadData(aReply);
+    }
+}
+
+void JobOutputHarvester::readDownloadData(ServiceRequest * theReply)
+{
+    if (!downloadWrites.contains(theReply)) return;
+    if (theReply->bytesAvailable() <= 0) return;
+
+    QByteArray newData = theReply->readAll();
+    downloadChecksums.value(theReply)->addData(newData);
+    myWriterPool->writeChunk(downloadWrites.value(theReply), newData);
+}
+
+void JobOutputHarvester::startDownloads(HarvestTask * theTask)
+{
+    while ((theTask->activeDownloads < HARVEST_PARALLEL_DOWNLOADS) && !theTask->waitingFiles.isEmpty())
+    {
+        QString fileName = theTask->waitingFiles.takeFirst();
+        int fileID = myWriterPool->openFile(QString("%1/%2").arg(theTask->localFolder, fileName), theTask->expectedSizes.value(fileName));
+
+        QString remotePath = theTask->remoteFolder.isEmpty() ? fileName : QString("%1/%2").arg(theTask->remoteFolder, fileName);
+        ServiceRequest * fileReply = ae_globals::get_Driver()->readJobOutput(theTask->jobID, remotePath);
+        fileReply->setProperty("jobID", theTask->jobID);
+        fileReply->setProperty("fileName", fileName);
+        fileReply->setReadBufferSize(HARVEST_READ_BUFFER);
+        downloadWrites.insert(fileReply, fileID);
+
+        //Server checksums from Agave are MD5, otherwise the faster hash is used
+        ChecksumType checksumType = theTask->serverChecksums.contains(fileName) ? ChecksumType::MD5 : ChecksumType::XXH64;
+        downloadChecksums.insert(fileReply, new StreamChecksum(checksumType));
+        theTask->activeDownloads++;
+
+        QObject::connect(fileReply, SIGNAL(readyRead()), this, SLOT(downloadDataReady()));
+        QObject::connect(fileReply, SIGNAL(finished()), this, SLOT(downloadReply()));
+        fileReply->start();
+    }
+
+    if (theTask->listingDone && (theTask->activeDownloads == 0) && theTask->waitingFiles.isEmpty())
+    {
+        finishHarvest(theTask);
+    }
+}
+
+void JobOutputHarvester::finishHarvest(HarvestTask * theTask)
+{
+    qint64 elapsedMs = theTask->harvestTimer.elapsed();
+    double throughput = 0;
+    if (elapsedMs > 0)
+    {
+        throughput = (theTask->bytesDone / 1024.0) / (elapsedMs / 1000.0);
+    }
+    qCDebug(agaveAppLayer, "Harvest of job %s done: %d files, %d failed, %lld bytes in %lld ms (%.1f KB/s)",
+            qPrintable(theTask->jobID), theTask->filesDone, theTask->filesFailed, theTask->bytesDone, elapsedMs, throughput);
+
+    QFile harvestLog(QString("%1/harvestLog.json").arg(theTask->localFolder));
+    if (QDir(theTask->localFolder).exists() && harvestLog.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        QJsonObject logEntry;
+        logEntry.insert("jobId", theTask->jobID);
+        logEntry.insert("completed", QDateTime::currentDateTime().toString(Qt::ISODate));
+        logEntry.insert("files", theTask->filesDone);
+        logEntry.insert("failed", theTask->filesFailed);
+        logEntry.insert("bytes", theTask->bytesDone);
+        logEntry.insert("elapsedMs", elapsedMs);
+        logEntry.insert("kbPerSecond", throughput);
+        logEntry.insert("checksums", theTask->fileChecksums);
+        harvestLog.write(QJsonDocument(logEntry).toJson(QJsonDocument::Compact));
+        harvestLog.write("\n");
+    }
+
+    activeHarvests.remove(theTask->jobID);
+    delete theTask;
+}
@@ -0,0 +1,129 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef JOBOUTPUTHARVESTER_H
+#define JOBOUTPUTHARVESTER_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+#include "remotejobdata.h"
+#include "utilFuncs/listingstreamparser.h"
+#include "utilFuncs/streamchecksum.h"
+
+class DiskWriterPool;
+class ServiceRequest;
+
+/*! \brief The JobOutputHarvester downloads selected outputs of a job as soon as the job finishes.
+ *
+ *  Harvest rules are set per Agave app, by its name without the version suffix, in the form: "output/run*.csv -> ~/runs/<jobId>"
+ *  The left side is a folder of the job output, and a wildcard for file names in that folder. The right side is a local folder, in which <jobId> is replaced by the job's ID.
+ *
+ *  When jobFinished() is called for a job whose app has a rule, the output folder is listed, and the matching files are downloaded several at a time.
+ *  The listing is read as it arrives, so downloads start before a long listing has finished.
+ *  Rules are kept in QSettings, under the group given at construction. Results for each job are logged, and appended to harvestLog.json in the local folder.
+ *  The listing and downloads are ServiceRequests, sent through the session's net manager.
+ *  Files are written by the DiskWriterPool, and reading from the network pauses while the pool is backed up.
+ *  Each file is checksummed as it is written. If the listing gives a checksum for a file, a download which does not match it is discarded. Otherwise, the checksum is recorded in the harvest log.
+ */
+
+class JobOutputHarvester : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobOutputHarvester(QString settingsGroup, QObject *parent = nullptr);
+
+    void setHarvestRule(QString appName, QString rule);
+    QString getHarvestRule(QString appName);
+
+public slots:
+    void jobFinished(RemoteJobData finishedJob);
+
+private slots:
+    void listingDataReady();
+    void listingReply();
+    void downloadDataReady();
+    void downloadReply();
+    void fileWriteClosed(int fileID, bool succeeded, qint64 bytesWritten, QString errorText);
+    void writerDrained();
+
+private:
+    struct HarvestTask
+    {
+        QString jobID;
+        QString remoteFolder;
+        QString fileFilter;
+        QString localFolder;
+        QStringList waitingFiles;
+        QMap<QString, QString> serverChecksums;
+        QMap<QString, qint64> expectedSizes;
+        QJsonObject fileChecksums;
+        ListingStreamParser listParser;
+        bool listingDone = false;
+        int activeDownloads = 0;
+        int filesDone = 0;
+        int filesFailed = 0;
+        qint64 bytesDone = 0;
+        QElapsedTimer harvestTimer;
+    };
+
+    struct ClosingFile
+    {
+        QString jobID;
+        QString fileName;
+        QString checksum;
+        QString failure;
+    };
+
+    void readDownloadData(ServiceRequest * theReply);
+    void takeListedFiles(HarvestTask * theTask);
+    void startDownloads(HarvestTask * theTask);
+    void finishHarvest(HarvestTask * theTask);
+
+    QString mySettingsGroup;
+    QMap<QString, QString> harvestRules;
+
+    DiskWriterPool * myWriterPool;
+    QMap<QString, HarvestTask *> activeHarvests;
+    QMap<ServiceRequest *, int> downloadWrites;
+    QMap<ServiceRequest *, StreamChecksum *> downloadChecksums;
+    QMap<int, ClosingFile> closingFiles;
+};
+
+#endif // JOBOUTPUTHARVESTER_H
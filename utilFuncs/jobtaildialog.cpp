@@ -0,0 +1,155 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "jobtaildialog.h"
+
+#include <QVBoxLayout>
+#include <QPlainTextEdit>
+#include <QLabel>
+#include <QCloseEvent>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#include "utilFuncs/agavesetupdriver.h"
+#include "utilFuncs/servicerequest.h"
+#include "ae_globals.h"
+
+static const int TAIL_MIN_INTERVAL = 1000;
+static const int TAIL_START_INTERVAL = 2000;
+static const int TAIL_MAX_INTERVAL = 60000;
+
+JobTailDialog::JobTailDialog(QString jobID, QString logFileName, QWidget *parent) : QDialog(parent)
+{
+    myJobID = jobID;
+    myLogFileName = logFileName;
+    logDecoder = QTextCodec::codecForName("UTF-8")->makeDecoder();
+
+    setWindowTitle(QString("Output of %1").arg(myLogFileName));
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(800, 500);
+
+    QVBoxLayout * tailLayout = new QVBoxLayout(this);
+    statusLabel = new QLabel("Waiting for log data . . .");
+    logView = new QPlainTextEdit();
+    logView->setReadOnly(true);
+    logView->setMaximumBlockCount(10000);
+    tailLayout->addWidget(statusLabel);
+    tailLayout->addWidget(logView);
+
+    pollInterval = TAIL_START_INTERVAL;
+    pollTimer.setSingleShot(true);
+    QObject::connect(&pollTimer, SIGNAL(timeout()), this, SLOT(sendPoll()));
+    sendPoll();
+}
+
+JobTailDialog::~JobTailDialog()
+{
+    pollTimer.stop();
+    if (pendingPoll != nullptr)
+    {
+        QObject::disconnect(pendingPoll, nullptr, this, nullptr);
+        pendingPoll->abort();
+        pendingPoll->deleteLater();
+    }
+    delete logDecoder;
+}
+
+qint64 JobTailDialog::getBytesReceived()
+{
+    return logOffset;
+}
+
+void JobTailDialog::closeEvent(QCloseEvent * event)
+{
+    pollTimer.stop();
+    qCDebug(agaveAppLayer, "Job log tail closed: %lld bytes in %d polls", logOffset, pollCount);
+    event->accept();
+}
+
+void JobTailDialog::sendPoll()
+{
+    if (pendingPoll != nullptr) return;
+
+    pendingPoll = ae_globals::get_Driver()->readJobOutput(myJobID, myLogFileName, logOffset);
+    QObject::connect(pendingPoll, SIGNAL(finished()), this, SLOT(pollReply()));
+    pendingPoll->start();
+    pollCount++;
+}
+
+void JobTailDialog::pollReply()
+{
+    ServiceRequest * theReply = pendingPoll;
+    pendingPoll = nullptr;
+    theReply->deleteLater();
+
+    int httpStatus = theReply->getHttpStatus();
+    QByteArray newData;
+
+    if (httpStatus == 206)
+    {
+        newData = theReply->readAll();
+    }
+    else if (httpStatus == 200)
+    {
+        //Server ignored the range, so skip what has already been shown
+        newData = theReply->readAll().mid(logOffset);
+    }
+    else if (httpStatus != 416)
+    {
+        statusLabel->setText(QString("Unable to read log: %1").arg(theReply->errorString()));
+        setPollInterval(pollInterval * 2);
+        return;
+    }
+
+    if (newData.isEmpty())
+    {
+        setPollInterval(pollInterval * 2);
+    }
+    else
+    {
+        logOffset += newData.size();
+        logView->moveCursor(QTextCursor::End);
+        logView->insertPlainText(logDecoder->toUnicode(newData));
+        logView->moveCursor(QTextCursor::End);
+        setPollInterval(pollInterval / 2);
+    }
+    statusLabel->setText(QString("%1 bytes read. Next check in %2 seconds.").arg(logOffset).arg(pollInterval / 1000));
+}
+
+void JobTailDialog::setPollInterval(int newInterval)
+{
+    pollInterval = qBound(TAIL_MIN_INTERVAL, newInterval, TAIL_MAX_INTERVAL);
+    pollTimer.start(pollInterval);
+}
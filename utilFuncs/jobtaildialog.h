@@ -0,0 +1,91 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef JOBTAILDIALOG_H
+#define JOBTAILDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+
+class QPlainTextEdit;
+class QLabel;
+class QTextDecoder;
+class ServiceRequest;
+
+/*! \brief The JobTailDialog shows the growing output log of a running remote job.
+ *
+ *  The log is polled with HTTP range requests, starting at the end of the data already shown, so each poll only transfers new bytes.
+ *  Polls go through the session's readJobOutput(). A poll may end partway through a character, so the log is decoded by a decoder which keeps the incomplete bytes for the next poll.
+ *  The poll interval shortens while the log is growing, and lengthens while it is not.
+ *
+ *  The dialog is non-modal, and stops polling when it is closed.
+ */
+
+class JobTailDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit JobTailDialog(QString jobID, QString logFileName, QWidget *parent = nullptr);
+    ~JobTailDialog();
+
+    qint64 getBytesReceived();
+
+protected:
+    virtual void closeEvent(QCloseEvent * event);
+
+private slots:
+    void sendPoll();
+    void pollReply();
+
+private:
+    void setPollInterval(int newInterval);
+
+    QString myJobID;
+    QString myLogFileName;
+
+    QPlainTextEdit * logView;
+    QLabel * statusLabel;
+
+    QTextDecoder * logDecoder;
+    ServiceRequest * pendingPoll = nullptr;
+    QTimer pollTimer;
+    int pollInterval;
+
+    qint64 logOffset = 0;
+    int pollCount = 0;
+};
+
+#endif // JOBTAILDIALOG_H
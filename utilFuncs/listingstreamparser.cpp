@@ -0,0 +1,202 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "listingstreamparser.h"
+
+#include <QJsonDocument>
+
+#include "ae_globals.h"
+
+//The depth of the result array's entries: inside the reply object, then inside the array
+static const int RESULT_ENTRY_DEPTH = 2;
+
+ListingStreamParser::ListingStreamParser() {}
+
+void ListingStreamParser::addData(const QByteArray &newData)
+{
+    if ((myPhase == ScanPhase::DONE) || (myPhase == ScanPhase::FAILED)) return;
+
+    pendingData.append(newData);
+    scanBuffer();
+    compactBuffer();
+}
+
+bool ListingStreamParser::hasEntry()
+{
+    return !readyEntries.isEmpty();
+}
+
+QJsonObject ListingStreamParser::takeEntry()
+{
+    if (readyEntries.isEmpty()) return QJsonObject();
+    return readyEntries.takeFirst();
+}
+
+bool ListingStreamParser::resultComplete()
+{
+    return (myPhase == ScanPhase::DONE);
+}
+
+bool ListingStreamParser::hasError()
+{
+    return (myPhase == ScanPhase::FAILED);
+}
+
+qint64 ListingStreamParser::getBufferedBytes()
+{
+    return pendingData.size();
+}
+
+void ListingStreamParser::scanBuffer()
+{
+    const char * rawData = pendingData.constData();
+    int dataLength = pendingData.size();
+
+    for (; scanPos < dataLength; scanPos++)
+    {
+        char aChar = rawData[scanPos];
+
+        if (inString)
+        {
+            if (escaped)
+            {
+                escaped = false;
+            }
+            else if (aChar == '\\')
+            {
+                escaped = true;
+            }
+            else if (aChar == '"')
+            {
+                inString = false;
+                if (keyStart >= 0)
+                {
+                    keyIsResult = (QByteArray::fromRawData(rawData + keyStart, scanPos - keyStart) == "result");
+                    keyStart = -1;
+                }
+            }
+            continue;
+        }
+
+        switch (aChar)
+        {
+        case ' ': case '\t': case '\r': case '\n':
+            continue;
+        case '"':
+            inString = true;
+            if ((depth == 1) && expectingKey)
+            {
+                keyStart = scanPos + 1;
+                expectingKey = false;
+            }
+            else if (depth == 1)
+            {
+                awaitingValue = false;
+            }
+            continue;
+        case ':':
+            if (depth == 1) awaitingValue = true;
+            continue;
+        case ',':
+            if (depth == 1) expectingKey = true;
+            continue;
+        case '{':
+        case '[':
+            if ((myPhase == ScanPhase::SEEKING) && (depth == 1) && awaitingValue && keyIsResult && (aChar == '['))
+            {
+                myPhase = ScanPhase::IN_RESULT;
+            }
+            else if ((myPhase == ScanPhase::IN_RESULT) && (depth == RESULT_ENTRY_DEPTH) && (aChar == '{'))
+            {
+                entryStart = scanPos;
+            }
+            if (depth == 0) expectingKey = true;
+            if (depth == 1) awaitingValue = false;
+            depth++;
+            continue;
+        case '}':
+        case ']':
+            depth--;
+            if (depth < 0)
+            {
+                myPhase = ScanPhase::FAILED;
+                return;
+            }
+            if ((myPhase == ScanPhase::IN_RESULT) && (depth == RESULT_ENTRY_DEPTH) && (entryStart >= 0))
+            {
+                QJsonParseError parseError;
+                QJsonDocument entryDoc = QJsonDocument::fromJson(pendingData.mid(entryStart, scanPos - entryStart + 1), &parseError);
+                entryStart = -1;
+                if (parseError.error != QJsonParseError::NoError)
+                {
+                    qCDebug(agaveAppLayer, "Listing entry parse error: %s", qPrintable(parseError.errorString()));
+                    myPhase = ScanPhase::FAILED;
+                    return;
+                }
+                readyEntries.append(entryDoc.object());
+            }
+            else if ((myPhase == ScanPhase::IN_RESULT) && (depth == 1))
+            {
+                myPhase = ScanPhase::DONE;
+                return;
+            }
+            continue;
+        default:
+            if (depth == 1) awaitingValue = false;
+            continue;
+        }
+    }
+}
+
+void ListingStreamParser::compactBuffer()
+{
+    if ((myPhase == ScanPhase::DONE) || (myPhase == ScanPhase::FAILED))
+    {
+        pendingData.clear();
+        scanPos = 0;
+        return;
+    }
+
+    //Keep only what a partly read entry or key still needs
+    int keepFrom = scanPos;
+    if (entryStart >= 0) keepFrom = qMin(keepFrom, entryStart);
+    if (keyStart >= 0) keepFrom = qMin(keepFrom, keyStart);
+    if (keepFrom == 0) return;
+
+    pendingData.remove(0, keepFrom);
+    scanPos -= keepFrom;
+    if (entryStart >= 0) entryStart -= keepFrom;
+    if (keyStart >= 0) keyStart -= keepFrom;
+}
@@ -0,0 +1,87 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef LISTINGSTREAMPARSER_H
+#define LISTINGSTREAMPARSER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+
+/*! \brief The ListingStreamParser pulls the entries of an Agave listing reply out of the reply data as it arrives.
+ *
+ *  Agave listings, of files or of jobs, are a JSON object whose "result" value is an array of entries.
+ *  Data is given to addData() in whatever pieces it arrives in. Each entry of the result array is available from takeEntry() as soon as its closing brace has been seen.
+ *
+ *  Only the entry currently being read is held, rather than a document of the whole reply, so memory use does not grow with the size of the listing.
+ */
+
+class ListingStreamParser
+{
+public:
+    ListingStreamParser();
+
+    void addData(const QByteArray &newData);
+
+    bool hasEntry();
+    QJsonObject takeEntry();
+
+    bool resultComplete();
+    bool hasError();
+    qint64 getBufferedBytes();
+
+private:
+    enum class ScanPhase {SEEKING, IN_RESULT, DONE, FAILED};
+
+    void scanBuffer();
+    void compactBuffer();
+
+    QByteArray pendingData;
+    int scanPos = 0;
+    int entryStart = -1;
+    int keyStart = -1;
+
+    ScanPhase myPhase = ScanPhase::SEEKING;
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    bool expectingKey = false;
+    bool awaitingValue = false;
+    bool keyIsResult = false;
+
+    QList<QJsonObject> readyEntries;
+};
+
+#endif // LISTINGSTREAMPARSER_H
@@ -0,0 +1,195 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "localtreescanner.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRunnable>
+
+#include <algorithm>
+
+#include "ae_globals.h"
+
+class LocalScanTask : public QRunnable
+{
+public:
+    LocalScanTask(LocalTreeScanner * theScanner, QString relativePath)
+    {
+        myScanner = theScanner;
+        myPath = relativePath;
+    }
+
+    virtual void run()
+    {
+        myScanner->scanFolder(myPath);
+    }
+
+private:
+    LocalTreeScanner * myScanner;
+    QString myPath;
+};
+
+LocalTreeScanner::LocalTreeScanner(QString localRoot, QObject *parent) : QObject(parent)
+{
+    myRoot = QDir(localRoot).absolutePath();
+    myManifest.localRoot = myRoot;
+}
+
+LocalTreeScanner::~LocalTreeScanner()
+{
+    //Tasks hold a pointer to this scanner
+    scanPool.clear();
+    scanPool.waitForDone();
+}
+
+void LocalTreeScanner::startScan(int threadCount)
+{
+    scanTimer.start();
+    scanPool.setMaxThreadCount(qMax(1, threadCount));
+
+    pendingFolders.store(1);
+    scanPool.start(new LocalScanTask(this, QString()));
+}
+
+bool LocalTreeScanner::isFinished()
+{
+    return scanDone;
+}
+
+const UploadManifest &LocalTreeScanner::getManifest()
+{
+    return myManifest;
+}
+
+QJsonDocument LocalTreeScanner::getManifestJson()
+{
+    QJsonArray entryArray;
+    for (const ManifestEntry &anEntry : myManifest.entryList)
+    {
+        QJsonObject entryObject;
+        entryObject.insert("path", anEntry.relativePath);
+        entryObject.insert("type", anEntry.isFolder ? "dir" : "file");
+        if (!anEntry.isFolder) entryObject.insert("size", anEntry.size);
+        entryArray.append(entryObject);
+    }
+
+    QJsonObject manifestObject;
+    manifestObject.insert("localRoot", myManifest.localRoot);
+    manifestObject.insert("files", myManifest.fileCount);
+    manifestObject.insert("folders", myManifest.folderCount);
+    manifestObject.insert("totalBytes", myManifest.totalBytes);
+    manifestObject.insert("rejectedNames", QJsonArray::fromStringList(myManifest.rejectedNames));
+    manifestObject.insert("unreadableFolders", QJsonArray::fromStringList(myManifest.unreadableFolders));
+    manifestObject.insert("entries", entryArray);
+    return QJsonDocument(manifestObject);
+}
+
+void LocalTreeScanner::finishScan()
+{
+    std::sort(myManifest.entryList.begin(), myManifest.entryList.end(),
+              [](const ManifestEntry &entry1, const ManifestEntry &entry2) { return entry1.relativePath < entry2.relativePath; });
+    myManifest.rejectedNames.sort();
+    myManifest.scanTimeMs = scanTimer.elapsed();
+    scanDone = true;
+
+    qCDebug(agaveAppLayer, "Scanned %s: %d files, %d folders, %lld bytes, %d rejected names in %lld ms",
+            qPrintable(myRoot), myManifest.fileCount, myManifest.folderCount, myManifest.totalBytes,
+            myManifest.rejectedNames.size(), myManifest.scanTimeMs);
+    emit scanFinished();
+}
+
+void LocalTreeScanner::scanFolder(QString relativePath)
+{
+    QDir scanDir(relativePath.isEmpty() ? myRoot : QString("%1/%2").arg(myRoot, relativePath));
+    QString pathPrefix = relativePath.isEmpty() ? QString() : relativePath + '/';
+
+    //Results are gathered here, and merged into the manifest under one lock
+    QList<ManifestEntry> folderEntries;
+    QStringList folderRejects;
+    int fileCount = 0;
+    int folderCount = 0;
+    qint64 folderBytes = 0;
+
+    bool readable = scanDir.isReadable();
+    if (readable)
+    {
+        QFileInfoList entryInfoList = scanDir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::NoSort);
+        folderEntries.reserve(entryInfoList.size());
+
+        for (const QFileInfo &anEntry : entryInfoList)
+        {
+            QString entryName = anEntry.fileName();
+            QString entryPath = pathPrefix + entryName;
+
+            if (anEntry.isDir())
+            {
+                if (!ae_globals::isUploadableName(entryName)) folderRejects.append(entryPath);
+                if (anEntry.isSymLink()) continue;
+
+                folderEntries.append({entryPath, 0, true});
+                folderCount++;
+
+                pendingFolders.ref();
+                scanPool.start(new LocalScanTask(this, entryPath));
+            }
+            else
+            {
+                if (!ae_globals::isUploadableName(entryName)) folderRejects.append(entryPath);
+
+                folderEntries.append({entryPath, anEntry.size(), false});
+                fileCount++;
+                folderBytes += anEntry.size();
+            }
+        }
+    }
+
+    {
+        QMutexLocker resultLock(&manifestLock);
+        myManifest.entryList.append(folderEntries);
+        myManifest.rejectedNames.append(folderRejects);
+        if (!readable) myManifest.unreadableFolders.append(relativePath.isEmpty() ? myRoot : relativePath);
+        myManifest.fileCount += fileCount;
+        myManifest.folderCount += folderCount;
+        myManifest.totalBytes += folderBytes;
+    }
+
+    if (!pendingFolders.deref())
+    {
+        QMetaObject::invokeMethod(this, "finishScan", Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,111 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef LOCALTREESCANNER_H
+#define LOCALTREESCANNER_H
+
+#include <QObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QJsonDocument>
+
+struct ManifestEntry
+{
+    QString relativePath;
+    qint64 size;
+    bool isFolder;
+};
+
+struct UploadManifest
+{
+    QString localRoot;
+    QList<ManifestEntry> entryList;
+    QStringList rejectedNames;
+    QStringList unreadableFolders;
+
+    int fileCount = 0;
+    int folderCount = 0;
+    qint64 totalBytes = 0;
+    qint64 scanTimeMs = 0;
+};
+
+/*! \brief The LocalTreeScanner walks a local folder tree before it is uploaded, and produces an UploadManifest of its contents.
+ *
+ *  Every folder is listed as a separate task in a thread pool, so wide trees are listed in parallel. Each name is checked for characters the remote file service cannot store, and file sizes are totaled.
+ *  Names that would be rejected are listed in the manifest, as are folders that could not be read. Symbolic links to folders are not followed.
+ *
+ *  scanFinished() is emitted, in the scanner's thread, once every folder has been listed.
+ */
+
+class LocalTreeScanner : public QObject
+{
+    Q_OBJECT
+
+    friend class LocalScanTask;
+
+public:
+    explicit LocalTreeScanner(QString localRoot, QObject *parent = nullptr);
+    ~LocalTreeScanner();
+
+    void startScan(int threadCount = QThread::idealThreadCount());
+    bool isFinished();
+
+    const UploadManifest &getManifest();
+    QJsonDocument getManifestJson();
+
+signals:
+    void scanFinished();
+
+private slots:
+    void finishScan();
+
+private:
+    void scanFolder(QString relativePath);
+
+    QString myRoot;
+    QThreadPool scanPool;
+
+    QMutex manifestLock;
+    UploadManifest myManifest;
+    QAtomicInt pendingFolders;
+    QElapsedTimer scanTimer;
+    bool scanDone = false;
+};
+
+#endif // LOCALTREESCANNER_H
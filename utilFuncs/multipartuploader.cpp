@@ -0,0 +1,311 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "multipartuploader.h"
+
+#include <QFileInfo>
+#include <QTimer>
+#include <QJsonObject>
+#include <QMultiMap>
+
+#include "remotedatainterface.h"
+
+#include "utilFuncs/agavesetupdriver.h"
+#include "utilFuncs/servicerequest.h"
+#include "ae_globals.h"
+
+static const int MAX_PART_ATTEMPTS = 4;
+static const int PART_RETRY_DELAY_MS = 2000;
+
+MultipartUploader::MultipartUploader(QString localFileName, QString remoteFolder, qint64 partSize, int maxParallel, QObject *parent) : QObject(parent)
+{
+    sourceFile.setFileName(localFileName);
+    myRemoteFolder = remoteFolder;
+
+    //The folder goes after the storage system in the media URL, so it has no slashes at either end
+    myUploadFolder = remoteFolder;
+    while (myUploadFolder.startsWith('/')) myUploadFolder.remove(0, 1);
+    while (myUploadFolder.endsWith('/')) myUploadFolder.chop(1);
+    myRemoteName = QFileInfo(localFileName).fileName();
+    myPartSize = qMax((qint64) 1024 * 1024, partSize);
+    myMaxParallel = qMax(1, maxParallel);
+
+    AgaveSetupDriver * theDriver = ae_globals::get_Driver();
+    if (theDriver != nullptr)
+    {
+        setConnection(theDriver->getDataConnection(), theDriver->getNetManager(), theDriver->getStorageSystem());
+    }
+}
+
+MultipartUploader::~MultipartUploader()
+{
+    cancel();
+}
+
+void MultipartUploader::setConnection(RemoteDataInterface * theConnection, TrafficNetManager * theNetManager, QString storageSystem)
+{
+    myConnection = theConnection;
+    myNetManager = theNetManager;
+    myStorageSystem = storageSystem;
+}
+
+bool MultipartUploader::start(QString * errorText)
+{
+    if ((myConnection == nullptr) || (myNetManager == nullptr))
+    {
+        if (errorText != nullptr) *errorText = QString("Not connected to a storage system.");
+        return false;
+    }
+
+    if (!sourceFile.open(QIODevice::ReadOnly))
+    {
+        if (errorText != nullptr) *errorText = QString("Unable to read file: %1").arg(sourceFile.fileName());
+        return false;
+    }
+
+    qint64 fileSize = sourceFile.size();
+    int partCount = qMax((qint64) 1, (fileSize + myPartSize - 1) / myPartSize);
+    if (partCount > 9999)
+    {
+        if (errorText != nullptr) *errorText = QString("File is too large for the upload part size.");
+        sourceFile.close();
+        return false;
+    }
+
+    partList.resize(partCount);
+    for (int i = 0; i < partCount; i++)
+    {
+        partList[i].offset = i * myPartSize;
+        partList[i].length = qMin(myPartSize, fileSize - partList[i].offset);
+        waitingParts.append(i);
+    }
+
+    qCDebug(agaveAppLayer, "Uploading %s in %d parts", qPrintable(sourceFile.fileName()), partCount);
+    sendMoreParts();
+    return true;
+}
+
+void MultipartUploader::cancel()
+{
+    if (finished) return;
+    finished = true;
+    waitingParts.clear();
+
+    for (ServiceRequest * aReply : activeReplies.keys())
+    {
+        aReply->disconnect(this);
+        aReply->abort();
+        aReply->deleteLater();
+    }
+    activeReplies.clear();
+    removeSentParts();
+}
+
+qint64 MultipartUploader::getTotalBytes()
+{
+    return sourceFile.size();
+}
+
+int MultipartUploader::getPartCount()
+{
+    return partList.size();
+}
+
+int MultipartUploader::getRetryCount()
+{
+    return retryCount;
+}
+
+int MultipartUploader::getRemovedPartCount()
+{
+    return removedCount;
+}
+
+void MultipartUploader::partProgress(qint64 bytesSent, qint64)
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (!activeReplies.contains(theReply)) return;
+    partList[activeReplies.value(theReply)].bytesSent = bytesSent;
+
+    qint64 totalSent = 0;
+    for (const UploadPart &aPart : partList)
+    {
+        totalSent += aPart.done ? aPart.length : qMin(aPart.bytesSent, aPart.length);
+    }
+    emit uploadProgress(totalSent, sourceFile.size());
+}
+
+void MultipartUploader::partReply()
+{
+    ServiceRequest * theReply = qobject_cast<ServiceRequest *>(sender());
+    if (!activeReplies.contains(theReply)) return;
+    theReply->deleteLater();
+
+    int partIndex = activeReplies.take(theReply);
+    UploadPart &thePart = partList[partIndex];
+
+    if ((theReply->error() == QNetworkReply::NoError) && !theReply->getUploadChecksum().isEmpty())
+    {
+        thePart.checksum = theReply->getUploadChecksum();
+        thePart.done = true;
+        partsDone++;
+        qCDebug(agaveAppLayer, "Upload part %d of %d done", partsDone, partList.size());
+    }
+    else if (thePart.attempts < MAX_PART_ATTEMPTS)
+    {
+        qCDebug(agaveAppLayer, "Upload part %d failed, will retry: %s", partIndex, qPrintable(theReply->errorString()));
+        thePart.bytesSent = 0;
+        retryCount++;
+        QTimer::singleShot(PART_RETRY_DELAY_MS * thePart.attempts, this, [this, partIndex]() {
+            if (finished) return;
+            waitingParts.prepend(partIndex);
+            sendMoreParts();
+        });
+        return;
+    }
+    else
+    {
+        failUpload(QString("Upload of %1 failed: %2").arg(partName(partIndex), theReply->errorString()));
+        return;
+    }
+
+    if (partsDone == partList.size())
+    {
+        startAssembly();
+        return;
+    }
+    sendMoreParts();
+}
+
+void MultipartUploader::assemblyReply(RequestState replyState, QJsonDocument rawReply)
+{
+    if (replyState != RequestState::GOOD)
+    {
+        removeSentParts();
+        emit uploadFinished(false, QString("All parts of %1 were uploaded, but the job to join them could not be started. The parts have been removed.").arg(myRemoteName));
+        return;
+    }
+
+    QString jobID = rawReply.object().value("result").toObject().value("id").toString();
+    emit uploadFinished(true, QString("All parts of %1 were uploaded. Job %2 will join them.").arg(myRemoteName, jobID));
+}
+
+void MultipartUploader::sendMoreParts()
+{
+    while (!finished && !waitingParts.isEmpty() && (activeReplies.size() < myMaxParallel))
+    {
+        sendPart(waitingParts.takeFirst());
+    }
+}
+
+void MultipartUploader::sendPart(int partIndex)
+{
+    UploadPart &thePart = partList[partIndex];
+    thePart.attempts++;
+
+    //The request maps the part itself, on the net manager's thread, and hashes it as it is sent
+    ServiceRequest * newReply = new ServiceRequest(myNetManager, QNetworkAccessManager::PostOperation,
+                                                   QString("/files/v2/media/system/%1/%2").arg(myStorageSystem, myUploadFolder));
+    newReply->setUploadFile(partName(partIndex), sourceFile.fileName(), thePart.offset, thePart.length);
+    activeReplies.insert(newReply, partIndex);
+    sentParts.insert(partIndex);
+
+    QObject::connect(newReply, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(partProgress(qint64,qint64)));
+    QObject::connect(newReply, SIGNAL(finished()), this, SLOT(partReply()));
+    newReply->start();
+}
+
+void MultipartUploader::startAssembly()
+{
+    finished = true;
+    sourceFile.close();
+
+    QStringList partNames;
+    QStringList partChecksums;
+    for (int i = 0; i < partList.size(); i++)
+    {
+        partNames.append(partName(i));
+        partChecksums.append(partList.at(i).checksum);
+    }
+
+    QMultiMap<QString, QString> jobParams;
+    jobParams.insert("parts", partNames.join(' '));
+    jobParams.insert("checksums", partChecksums.join(' '));
+    jobParams.insert("output", myRemoteName);
+
+    RemoteDataReply * jobReply = myConnection->runRemoteJob("assemble-parts", jobParams, myRemoteFolder);
+    if (jobReply == nullptr)
+    {
+        removeSentParts();
+        emit uploadFinished(false, QString("All parts of %1 were uploaded, but the job to join them could not be started. The parts have been removed.").arg(myRemoteName));
+        return;
+    }
+    QObject::connect(jobReply, SIGNAL(haveJobReply(RequestState,QJsonDocument)), this, SLOT(assemblyReply(RequestState,QJsonDocument)));
+}
+
+void MultipartUploader::failUpload(QString message)
+{
+    cancel();
+    sourceFile.close();
+    emit uploadFinished(false, message);
+}
+
+void MultipartUploader::removeSentParts()
+{
+    //A part which was cut off partway may also have been left behind, so every part sent is removed
+    QString folderPath = myUploadFolder.isEmpty() ? QString() : QString("/%1").arg(myUploadFolder);
+    for (int partIndex : sentParts)
+    {
+        RemoteDataReply * removeReply = myConnection->deleteFile(QString("%1/%2").arg(folderPath, partName(partIndex)));
+        if (removeReply == nullptr) continue;
+        QObject::connect(removeReply, SIGNAL(haveDeleteReply(RequestState)), this, SLOT(partRemoved(RequestState)));
+    }
+    sentParts.clear();
+}
+
+void MultipartUploader::partRemoved(RequestState replyState)
+{
+    if (replyState != RequestState::GOOD)
+    {
+        qCDebug(agaveAppLayer, "Unable to remove an upload part of %s", qPrintable(myRemoteName));
+        return;
+    }
+    removedCount++;
+}
+
+QString MultipartUploader::partName(int partIndex)
+{
+    return QString("%1.part%2").arg(myRemoteName).arg(partIndex, 4, 10, QChar('0'));
+}
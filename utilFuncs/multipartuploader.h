@@ -0,0 +1,132 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef MULTIPARTUPLOADER_H
+#define MULTIPARTUPLOADER_H
+
+#include <QObject>
+#include <QFile>
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QJsonDocument>
+
+class ServiceRequest;
+class RemoteDataInterface;
+class TrafficNetManager;
+enum class RequestState;
+
+/*! \brief The MultipartUploader uploads one large local file as several parts at once, then submits a job to join the parts on the remote side.
+ *
+ *  The file is split into fixed-size parts, named <file>.part0000, <file>.part0001, and so on, in the destination folder. Several parts are uploaded at a time, each on its own connection.
+ *  Each part is a ServiceRequest, sent through the session's net manager with the token current at the time, so a long upload carries on past a token refresh.
+ *  Each part is read from a memory map of that part of the file, so the file is never copied into memory. A failed part is retried a few times before the upload is given up.
+ *  If the upload fails or is cancelled, any parts already sent are removed from the destination folder.
+ *
+ *  The uploader uses the connection of the program's driver, unless another session's connection is given with setConnection() before start().
+ *
+ *  Once every part is uploaded, the "assemble-parts" app is run in the destination folder, with the part names, their checksums and the output name as parameters. That app is set with the assemblyApp argument.
+ *  Part checksums are XXH64, taken by each part's ServiceRequest as the mapped data is sent, so the file is read only once.
+ */
+
+class MultipartUploader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MultipartUploader(QString localFileName, QString remoteFolder, qint64 partSize, int maxParallel = 4, QObject *parent = nullptr);
+    ~MultipartUploader();
+
+    void setConnection(RemoteDataInterface * theConnection, TrafficNetManager * theNetManager, QString storageSystem);
+
+    bool start(QString * errorText = nullptr);
+    void cancel();
+
+    qint64 getTotalBytes();
+    int getPartCount();
+    int getRetryCount();
+    int getRemovedPartCount();
+
+signals:
+    void uploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void uploadFinished(bool succeeded, QString message);
+
+private slots:
+    void partProgress(qint64 bytesSent, qint64 bytesTotal);
+    void partReply();
+    void assemblyReply(RequestState replyState, QJsonDocument rawReply);
+    void partRemoved(RequestState replyState);
+
+private:
+    struct UploadPart
+    {
+        qint64 offset = 0;
+        qint64 length = 0;
+        int attempts = 0;
+        qint64 bytesSent = 0;
+        bool done = false;
+        QString checksum;
+    };
+
+    void sendMoreParts();
+    void sendPart(int partIndex);
+    void startAssembly();
+    void failUpload(QString message);
+    void removeSentParts();
+
+    QString partName(int partIndex);
+
+    RemoteDataInterface * myConnection = nullptr;
+    TrafficNetManager * myNetManager = nullptr;
+    QString myStorageSystem;
+
+    QFile sourceFile;
+    QString myRemoteFolder;
+    QString myUploadFolder;
+    QString myRemoteName;
+    qint64 myPartSize;
+    int myMaxParallel;
+
+    QVector<UploadPart> partList;
+    QList<int> waitingParts;
+    QMap<ServiceRequest *, int> activeReplies;
+    QSet<int> sentParts;
+    int partsDone = 0;
+    int retryCount = 0;
+    int removedCount = 0;
+    bool finished = false;
+};
+
+#endif // MULTIPARTUPLOADER_H
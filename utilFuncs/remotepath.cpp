@@ -0,0 +1,235 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "remotepath.h"
+
+#include <QVector>
+#include <QVarLengthArray>
+#include <QReadWriteLock>
+
+//Entry 0 of the table is always the root folder
+static const quint32 ROOT_PATH_ID = 0;
+
+struct RemotePathEntry
+{
+    quint32 parentID;
+    quint32 nameID;
+    int depth;
+    uint pathHash;
+};
+
+class RemotePathTable
+{
+public:
+    RemotePathTable()
+    {
+        nameList.append(QString());
+        pathList.append({ROOT_PATH_ID, 0, 0, qHash(QString())});
+    }
+
+    quint32 internChild(quint32 parentID, const QStringRef &childName)
+    {
+        {
+            QReadLocker readLock(&tableLock);
+            quint32 existingID;
+            if (findChild(parentID, childName, &existingID)) return existingID;
+        }
+
+        QWriteLocker writeLock(&tableLock);
+        quint32 existingID;
+        if (findChild(parentID, childName, &existingID)) return existingID;
+
+        QString nameString = childName.toString();
+        quint32 nameID = nameIDs.value(nameString, (quint32) nameList.size());
+        if (nameID == (quint32) nameList.size())
+        {
+            nameList.append(nameString);
+            nameIDs.insert(nameString, nameID);
+        }
+
+        quint32 newID = pathList.size();
+        RemotePathEntry parentEntry = pathList.at(parentID);
+        pathList.append({parentID, nameID, parentEntry.depth + 1, qHash(nameString, parentEntry.pathHash)});
+        childIDs.insert(childKey(parentID, nameID), newID);
+        return newID;
+    }
+
+    RemotePathEntry getEntry(quint32 pathID)
+    {
+        QReadLocker readLock(&tableLock);
+        return pathList.at(pathID);
+    }
+
+    QString getName(quint32 nameID)
+    {
+        QReadLocker readLock(&tableLock);
+        return nameList.at(nameID);
+    }
+
+    QString buildPath(quint32 pathID)
+    {
+        QReadLocker readLock(&tableLock);
+        if (pathID == ROOT_PATH_ID) return QString("/");
+
+        QVarLengthArray<quint32, 32> nameChain;
+        int pathLength = 0;
+        for (quint32 walkID = pathID; walkID != ROOT_PATH_ID; walkID = pathList.at(walkID).parentID)
+        {
+            quint32 nameID = pathList.at(walkID).nameID;
+            nameChain.append(nameID);
+            pathLength += nameList.at(nameID).size() + 1;
+        }
+
+        QString fullPath;
+        fullPath.reserve(pathLength);
+        for (int i = nameChain.size() - 1; i >= 0; i--)
+        {
+            fullPath.append('/');
+            fullPath.append(nameList.at(nameChain.at(i)));
+        }
+        return fullPath;
+    }
+
+    int getCount()
+    {
+        QReadLocker readLock(&tableLock);
+        return pathList.size();
+    }
+
+private:
+    static quint64 childKey(quint32 parentID, quint32 nameID)
+    {
+        return (((quint64) parentID) << 32) | nameID;
+    }
+
+    bool findChild(quint32 parentID, const QStringRef &childName, quint32 * foundID)
+    {
+        //QHash can only look up a QString, so this copy is the one allocation a lookup makes
+        auto nameItr = nameIDs.constFind(childName.toString());
+        if (nameItr == nameIDs.constEnd()) return false;
+
+        auto childItr = childIDs.constFind(childKey(parentID, nameItr.value()));
+        if (childItr == childIDs.constEnd()) return false;
+
+        *foundID = childItr.value();
+        return true;
+    }
+
+    QReadWriteLock tableLock;
+    QVector<RemotePathEntry> pathList;
+    QVector<QString> nameList;
+    QHash<QString, quint32> nameIDs;
+    QHash<quint64, quint32> childIDs;
+};
+
+static RemotePathTable * pathTable()
+{
+    static RemotePathTable theTable;
+    return &theTable;
+}
+
+RemotePath::RemotePath()
+{
+    myID = ROOT_PATH_ID;
+    myHash = pathTable()->getEntry(ROOT_PATH_ID).pathHash;
+}
+
+RemotePath::RemotePath(const QString &fullPath)
+{
+    *this = RemotePath().getChild(fullPath);
+}
+
+RemotePath::RemotePath(quint32 pathID, uint pathHash)
+{
+    myID = pathID;
+    myHash = pathHash;
+}
+
+bool RemotePath::isRoot() const
+{
+    return (myID == ROOT_PATH_ID);
+}
+
+int RemotePath::getDepth() const
+{
+    return pathTable()->getEntry(myID).depth;
+}
+
+RemotePath RemotePath::getParent() const
+{
+    quint32 parentID = pathTable()->getEntry(myID).parentID;
+    return RemotePath(parentID, pathTable()->getEntry(parentID).pathHash);
+}
+
+RemotePath RemotePath::getChild(const QString &childName) const
+{
+    quint32 childID = myID;
+    for (const QStringRef &aName : childName.splitRef('/', QString::SkipEmptyParts))
+    {
+        childID = pathTable()->internChild(childID, aName);
+    }
+    return RemotePath(childID, pathTable()->getEntry(childID).pathHash);
+}
+
+bool RemotePath::isWithin(const RemotePath &folderPath) const
+{
+    int folderDepth = folderPath.getDepth();
+    RemotePath walkPath = *this;
+    while (walkPath.getDepth() > folderDepth)
+    {
+        walkPath = walkPath.getParent();
+    }
+    return (walkPath == folderPath);
+}
+
+QString RemotePath::getName() const
+{
+    return pathTable()->getName(pathTable()->getEntry(myID).nameID);
+}
+
+QString RemotePath::toString() const
+{
+    return pathTable()->buildPath(myID);
+}
+
+uint RemotePath::getHash() const
+{
+    return myHash;
+}
+
+int RemotePath::getInternedCount()
+{
+    return pathTable()->getCount();
+}
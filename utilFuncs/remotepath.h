@@ -0,0 +1,86 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef REMOTEPATH_H
+#define REMOTEPATH_H
+
+#include <QString>
+#include <QHash>
+
+/*! \brief A RemotePath is a small handle to an interned remote file path.
+ *
+ *  Every path is stored once, in a table shared by the whole program, as a name and a handle to its parent folder. Names are also stored only once.
+ *  Two RemotePaths are equal exactly when their handles are equal, and each handle carries its hash, so comparison, hashing and finding the parent do not touch any strings.
+ *
+ *  Paths are normalized when interned: "/a//b/" and "a/b" are the same RemotePath. The default RemotePath is the root, "/".
+ *  Interned paths are never removed, so a RemotePath stays valid for the life of the program, and may be used from any thread.
+ */
+
+class RemotePath
+{
+public:
+    RemotePath();
+    explicit RemotePath(const QString &fullPath);
+
+    bool isRoot() const;
+    int getDepth() const;
+
+    RemotePath getParent() const;
+    RemotePath getChild(const QString &childName) const;
+    bool isWithin(const RemotePath &folderPath) const;
+
+    QString getName() const;
+    QString toString() const;
+
+    uint getHash() const;
+
+    bool operator==(const RemotePath &other) const { return myID == other.myID; }
+    bool operator!=(const RemotePath &other) const { return myID != other.myID; }
+
+    static int getInternedCount();
+
+private:
+    RemotePath(quint32 pathID, uint pathHash);
+
+    quint32 myID;
+    uint myHash;
+};
+
+inline uint qHash(const RemotePath &aPath, uint seed = 0)
+{
+    return aPath.getHash() ^ seed;
+}
+
+#endif // REMOTEPATH_H
@@ -0,0 +1,415 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "servicerequest.h"
+
+#include <QHttpMultiPart>
+
+#include <string.h>
+
+#include "utilFuncs/trafficnetmanager.h"
+
+/*! \brief The MappedPartDevice gives a memory-mapped upload part to the network reply, and adds each byte to the part's checksum the first time it is read.
+ *
+ *  The reply may seek back and read again, on a resent request, so bytes before the hashed count are only copied.
+ */
+
+class MappedPartDevice : public QIODevice
+{
+public:
+    MappedPartDevice(const uchar * partData, qint64 partLength, StreamChecksum * checksum, qint64 * hashedCount, QObject *parent = nullptr) : QIODevice(parent)
+    {
+        myData = partData;
+        myLength = partLength;
+        myChecksum = checksum;
+        myHashedCount = hashedCount;
+    }
+
+    virtual qint64 size() const
+    {
+        return myLength;
+    }
+
+    virtual qint64 bytesAvailable() const
+    {
+        return myLength - pos() + QIODevice::bytesAvailable();
+    }
+
+protected:
+    virtual qint64 readData(char * data, qint64 maxSize)
+    {
+        qint64 readStart = pos();
+        qint64 readSize = qMin(maxSize, myLength - readStart);
+        if (readSize <= 0) return 0;
+
+        memcpy(data, myData + readStart, readSize);
+        if (readStart + readSize > *myHashedCount)
+        {
+            qint64 newStart = qMax(readStart, *myHashedCount);
+            myChecksum->addData((const char *) (myData + newStart), readStart + readSize - newStart);
+            *myHashedCount = readStart + readSize;
+        }
+        return readSize;
+    }
+
+    virtual qint64 writeData(const char *, qint64)
+    {
+        return -1;
+    }
+
+private:
+    const uchar * myData;
+    qint64 myLength;
+    StreamChecksum * myChecksum;
+    qint64 * myHashedCount;
+};
+
+ServiceRequest::ServiceRequest(TrafficNetManager * manager, QNetworkAccessManager::Operation op, QString servicePath, QObject *parent) : QObject(parent)
+{
+    myManager = manager;
+    myOperation = op;
+    myServicePath = servicePath;
+}
+
+ServiceRequest::~ServiceRequest()
+{
+    //The relay aborts the reply, if still running, as it is deleted
+    if (myRelay != nullptr)
+    {
+        myRelay->deleteLater();
+    }
+}
+
+ServiceRequest * ServiceRequest::jobOutputRead(TrafficNetManager * manager, QString jobID, QString outputPath, qint64 fromOffset)
+{
+    ServiceRequest * newRequest = new ServiceRequest(manager, QNetworkAccessManager::GetOperation, QString("/jobs/v2/%1/outputs/media/%2").arg(jobID, outputPath));
+    if (fromOffset > 0)
+    {
+        newRequest->setRawHeader("Range", QString("bytes=%1-").arg(fromOffset).toLatin1());
+    }
+    return newRequest;
+}
+
+void ServiceRequest::setRawHeader(QByteArray headerName, QByteArray headerValue)
+{
+    myHeaders.append(QNetworkReply::RawHeaderPair(headerName, headerValue));
+}
+
+void ServiceRequest::setBody(QByteArray body, QByteArray contentType)
+{
+    myBody = body;
+    myContentType = contentType;
+}
+
+void ServiceRequest::setUploadFile(QString uploadName, QString localFileName, qint64 offset, qint64 length)
+{
+    myUploadName = uploadName;
+    myLocalFileName = localFileName;
+    myUploadOffset = offset;
+    myUploadLength = length;
+}
+
+void ServiceRequest::setReadBufferSize(qint64 maxSize)
+{
+    readLimit = maxSize;
+}
+
+void ServiceRequest::start()
+{
+    if ((myRelay != nullptr) || (myManager == nullptr)) return;
+
+    myRelay = new ServiceRequestRelay(myManager, myOperation, myServicePath, readLimit);
+    myRelay->setContent(myHeaders, myBody, myContentType);
+    if (!myUploadName.isEmpty())
+    {
+        myRelay->setUploadFile(myUploadName, myLocalFileName, myUploadOffset, myUploadLength);
+    }
+    myRelay->moveToThread(myManager->thread());
+
+    QObject::connect(myRelay, SIGNAL(dataReceived(QByteArray)), this, SLOT(takeData(QByteArray)));
+    QObject::connect(myRelay, SIGNAL(uploadProgress(qint64,qint64)), this, SIGNAL(uploadProgress(qint64,qint64)));
+    QObject::connect(myRelay, SIGNAL(replyDone(int,QString,int,QString)), this, SLOT(takeResult(int,QString,int,QString)));
+    QMetaObject::invokeMethod(myRelay, "sendRequest", Qt::QueuedConnection);
+}
+
+void ServiceRequest::abort()
+{
+    if ((myRelay == nullptr) || requestDone) return;
+    QMetaObject::invokeMethod(myRelay, "abortRequest", Qt::QueuedConnection);
+}
+
+QString ServiceRequest::getServicePath()
+{
+    return myServicePath;
+}
+
+bool ServiceRequest::isFinished()
+{
+    return requestDone;
+}
+
+qint64 ServiceRequest::bytesAvailable()
+{
+    return receivedData.size();
+}
+
+QByteArray ServiceRequest::readAll()
+{
+    QByteArray readData = receivedData;
+    receivedData.clear();
+
+    //The relay holds back the network reply until the caller has read what was passed over
+    if ((readLimit > 0) && !readData.isEmpty() && (myRelay != nullptr))
+    {
+        QMetaObject::invokeMethod(myRelay, "dataConsumed", Qt::QueuedConnection, Q_ARG(qint64, readData.size()));
+    }
+    return readData;
+}
+
+QNetworkReply::NetworkError ServiceRequest::error()
+{
+    return myError;
+}
+
+QString ServiceRequest::errorString()
+{
+    return myErrorText;
+}
+
+int ServiceRequest::getHttpStatus()
+{
+    return myHttpStatus;
+}
+
+QString ServiceRequest::getUploadChecksum()
+{
+    return myUploadChecksum;
+}
+
+void ServiceRequest::takeData(QByteArray newData)
+{
+    receivedData.append(newData);
+    emit readyRead();
+}
+
+void ServiceRequest::takeResult(int networkError, QString errorText, int httpStatus, QString uploadChecksum)
+{
+    myError = (QNetworkReply::NetworkError) networkError;
+    myErrorText = errorText;
+    myHttpStatus = httpStatus;
+    myUploadChecksum = uploadChecksum;
+    requestDone = true;
+    emit finished();
+}
+
+ServiceRequestRelay::ServiceRequestRelay(TrafficNetManager * manager, QNetworkAccessManager::Operation op, QString servicePath, qint64 readLimit) : QObject(nullptr)
+{
+    myManager = manager;
+    myOperation = op;
+    myServicePath = servicePath;
+    myReadLimit = readLimit;
+}
+
+ServiceRequestRelay::~ServiceRequestRelay()
+{
+    //The reply may still read from the mapped file, so it goes first
+    if (myReply != nullptr)
+    {
+        QObject::disconnect(myReply, nullptr, this, nullptr);
+        if (!myReply->isFinished()) myReply->abort();
+        delete myReply;
+    }
+    if (mappedData != nullptr)
+    {
+        uploadFile.unmap(mappedData);
+    }
+}
+
+void ServiceRequestRelay::setContent(QList<QNetworkReply::RawHeaderPair> headers, QByteArray body, QByteArray contentType)
+{
+    myHeaders = headers;
+    myBody = body;
+    myContentType = contentType;
+}
+
+void ServiceRequestRelay::setUploadFile(QString uploadName, QString localFileName, qint64 offset, qint64 length)
+{
+    myUploadName = uploadName;
+    uploadFile.setFileName(localFileName);
+    myUploadOffset = offset;
+    myUploadLength = length;
+}
+
+void ServiceRequestRelay::sendRequest()
+{
+    if ((myReply != nullptr) || resultSent) return;
+
+    QNetworkRequest theRequest;
+    if (!myManager->signServiceRequest(theRequest, myServicePath))
+    {
+        resultSent = true;
+        emit replyDone(QNetworkReply::AuthenticationRequiredError, "Not logged in.", 0, QString());
+        return;
+    }
+    for (const QNetworkReply::RawHeaderPair &aHeader : myHeaders)
+    {
+        theRequest.setRawHeader(aHeader.first, aHeader.second);
+    }
+
+    QHttpMultiPart * uploadBody = nullptr;
+    if (!myUploadName.isEmpty())
+    {
+        if (uploadFile.open(QIODevice::ReadOnly))
+        {
+            mappedData = uploadFile.map(myUploadOffset, myUploadLength);
+        }
+        if (mappedData == nullptr)
+        {
+            resultSent = true;
+            emit replyDone(QNetworkReply::UnknownContentError, QString("Unable to read %1").arg(uploadFile.fileName()), 0, QString());
+            return;
+        }
+
+        //The part is read from the mapped file as the socket takes it, and hashed on the way
+        uploadBody = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+        MappedPartDevice * partDevice = new MappedPartDevice(mappedData, myUploadLength, &uploadChecksum, &bytesHashed, uploadBody);
+        partDevice->open(QIODevice::ReadOnly);
+        QHttpPart filePart;
+        filePart.setHeader(QNetworkRequest::ContentDispositionHeader, QString("form-data; name=\"fileToUpload\"; filename=\"%1\"").arg(myUploadName));
+        filePart.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+        filePart.setBodyDevice(partDevice);
+        uploadBody->append(filePart);
+    }
+    else if (!myContentType.isEmpty())
+    {
+        theRequest.setHeader(QNetworkRequest::ContentTypeHeader, myContentType);
+    }
+
+    switch (myOperation)
+    {
+    case QNetworkAccessManager::HeadOperation: myReply = myManager->head(theRequest); break;
+    case QNetworkAccessManager::GetOperation: myReply = myManager->get(theRequest); break;
+    case QNetworkAccessManager::DeleteOperation: myReply = myManager->deleteResource(theRequest); break;
+    case QNetworkAccessManager::PutOperation:
+        myReply = (uploadBody != nullptr) ? myManager->put(theRequest, uploadBody) : myManager->put(theRequest, myBody);
+        break;
+    default:
+        myReply = (uploadBody != nullptr) ? myManager->post(theRequest, uploadBody) : myManager->post(theRequest, myBody);
+        break;
+    }
+    if (uploadBody != nullptr)
+    {
+        uploadBody->setParent(myReply);
+    }
+
+    if (myReadLimit > 0)
+    {
+        myReply->setReadBufferSize(myReadLimit);
+    }
+    QObject::connect(myReply, SIGNAL(readyRead()), this, SLOT(forwardData()));
+    QObject::connect(myReply, SIGNAL(uploadProgress(qint64,qint64)), this, SIGNAL(uploadProgress(qint64,qint64)));
+    QObject::connect(myReply, SIGNAL(finished()), this, SLOT(replyFinished()));
+}
+
+void ServiceRequestRelay::abortRequest()
+{
+    if ((myReply == nullptr) || myReply->isFinished()) return;
+    myReply->abort();
+}
+
+void ServiceRequestRelay::dataConsumed(qint64 byteCount)
+{
+    bytesInTransit -= byteCount;
+    forwardData();
+
+    if (finishPending && (myReply->bytesAvailable() == 0))
+    {
+        sendResult();
+    }
+}
+
+void ServiceRequestRelay::forwardData()
+{
+    if (myReply == nullptr) return;
+
+    while (myReply->bytesAvailable() > 0)
+    {
+        qint64 readSize = myReply->bytesAvailable();
+        if (myReadLimit > 0)
+        {
+            readSize = qMin(readSize, myReadLimit - bytesInTransit);
+            if (readSize <= 0) return;
+        }
+
+        QByteArray newData = myReply->read(readSize);
+        if (newData.isEmpty()) return;
+        bytesInTransit += newData.size();
+        emit dataReceived(newData);
+    }
+}
+
+void ServiceRequestRelay::replyFinished()
+{
+    forwardData();
+
+    //The result follows the last of the data, once the caller has room for it
+    if (myReply->bytesAvailable() > 0)
+    {
+        finishPending = true;
+        return;
+    }
+    sendResult();
+}
+
+void ServiceRequestRelay::sendResult()
+{
+    if (resultSent) return;
+    resultSent = true;
+    finishPending = false;
+
+    QString checksumText;
+    if ((mappedData != nullptr) && (myReply->error() == QNetworkReply::NoError))
+    {
+        //A replayed reply never reads the body, so whatever was not sent is hashed here, still off the caller's thread
+        if (bytesHashed < myUploadLength)
+        {
+            uploadChecksum.addData((const char *) (mappedData + bytesHashed), myUploadLength - bytesHashed);
+            bytesHashed = myUploadLength;
+        }
+        checksumText = uploadChecksum.getResult();
+    }
+
+    emit replyDone(myReply->error(), myReply->errorString(), myReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), checksumText);
+}
@@ -0,0 +1,173 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef SERVICEREQUEST_H
+#define SERVICEREQUEST_H
+
+#include <QObject>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include "utilFuncs/streamchecksum.h"
+
+class TrafficNetManager;
+class ServiceRequestRelay;
+
+/*! \brief A ServiceRequest is an HTTP request which the app makes to the Agave service itself, rather than through the remote data interface.
+ *
+ *  The request is given as a path below the service address, such as /jobs/v2/<id>/outputs/media/<file>.
+ *  It is sent by the session's TrafficNetManager, on the manager's own thread, which adds the service address and the session's current access token. The caller never sees the token.
+ *  Like all other traffic, the request is recorded or replayed, and is cancelled by abortBulkTransfers() if it reads or writes file contents.
+ *
+ *  The ServiceRequest belongs to the caller's thread, and is read much like a QNetworkReply. Data is passed over from the manager's thread as it arrives.
+ *  A file upload is read from a memory map of the local file, which is made and released on the manager's thread.
+ *  The XXH64 checksum of the uploaded part is taken as the part is read into the socket, and is given by getUploadChecksum() once the request has finished.
+ *  With setReadBufferSize(), no more than that much data is passed over before the caller reads it, and the network reply is held back in the meantime.
+ */
+
+class ServiceRequest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ServiceRequest(TrafficNetManager * manager, QNetworkAccessManager::Operation op, QString servicePath, QObject *parent = nullptr);
+    ~ServiceRequest();
+
+    static ServiceRequest * jobOutputRead(TrafficNetManager * manager, QString jobID, QString outputPath, qint64 fromOffset = 0);
+
+    void setRawHeader(QByteArray headerName, QByteArray headerValue);
+    void setBody(QByteArray body, QByteArray contentType);
+    void setUploadFile(QString uploadName, QString localFileName, qint64 offset, qint64 length);
+    void setReadBufferSize(qint64 maxSize);
+
+    void start();
+    void abort();
+
+    QString getServicePath();
+    bool isFinished();
+    qint64 bytesAvailable();
+    QByteArray readAll();
+
+    QNetworkReply::NetworkError error();
+    QString errorString();
+    int getHttpStatus();
+    QString getUploadChecksum();
+
+signals:
+    void readyRead();
+    void uploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void finished();
+
+private slots:
+    void takeData(QByteArray newData);
+    void takeResult(int networkError, QString errorText, int httpStatus, QString uploadChecksum);
+
+private:
+    TrafficNetManager * myManager;
+    QNetworkAccessManager::Operation myOperation;
+    QString myServicePath;
+    QList<QNetworkReply::RawHeaderPair> myHeaders;
+    QByteArray myBody;
+    QByteArray myContentType;
+    QString myUploadName;
+    QString myLocalFileName;
+    qint64 myUploadOffset = 0;
+    qint64 myUploadLength = 0;
+    qint64 readLimit = 0;
+
+    ServiceRequestRelay * myRelay = nullptr;
+    QByteArray receivedData;
+    bool requestDone = false;
+    QNetworkReply::NetworkError myError = QNetworkReply::NoError;
+    QString myErrorText;
+    int myHttpStatus = 0;
+    QString myUploadChecksum;
+};
+
+/*! \brief The ServiceRequestRelay lives on the TrafficNetManager's thread. It sends one ServiceRequest, and passes the reply back to the caller's thread.
+ */
+
+class ServiceRequestRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ServiceRequestRelay(TrafficNetManager * manager, QNetworkAccessManager::Operation op, QString servicePath, qint64 readLimit);
+    ~ServiceRequestRelay();
+
+    void setContent(QList<QNetworkReply::RawHeaderPair> headers, QByteArray body, QByteArray contentType);
+    void setUploadFile(QString uploadName, QString localFileName, qint64 offset, qint64 length);
+
+signals:
+    void dataReceived(QByteArray newData);
+    void uploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void replyDone(int networkError, QString errorText, int httpStatus, QString uploadChecksum);
+
+public slots:
+    void sendRequest();
+    void abortRequest();
+    void dataConsumed(qint64 byteCount);
+
+private slots:
+    void forwardData();
+    void replyFinished();
+
+private:
+    void sendResult();
+
+    TrafficNetManager * myManager;
+    QNetworkAccessManager::Operation myOperation;
+    QString myServicePath;
+    QList<QNetworkReply::RawHeaderPair> myHeaders;
+    QByteArray myBody;
+    QByteArray myContentType;
+    QString myUploadName;
+    QFile uploadFile;
+    qint64 myUploadOffset = 0;
+    qint64 myUploadLength = 0;
+    uchar * mappedData = nullptr;
+    StreamChecksum uploadChecksum;
+    qint64 bytesHashed = 0;
+
+    QNetworkReply * myReply = nullptr;
+    qint64 myReadLimit;
+    qint64 bytesInTransit = 0;
+    bool finishPending = false;
+    bool resultSent = false;
+};
+
+#endif // SERVICEREQUEST_H
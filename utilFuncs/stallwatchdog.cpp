@@ -0,0 +1,242 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+
+#include "stallwatchdog.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QEvent>
+#include <QMetaObject>
+
+#include "ae_globals.h"
+
+static const qint64 LATENCY_BUCKET_LIMITS[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+static const int LATENCY_BUCKET_COUNT = sizeof(LATENCY_BUCKET_LIMITS) / sizeof(qint64) + 1;
+
+StallWatchdog * StallWatchdog::activeWatchdog = nullptr;
+
+class StallMonitorThread : public QThread
+{
+public:
+    explicit StallMonitorThread(StallWatchdog * theWatchdog) : QThread(theWatchdog), myWatchdog(theWatchdog) {}
+
+protected:
+    void run()
+    {
+        while (!isInterruptionRequested())
+        {
+            msleep(StallWatchdog::HEARTBEAT_MS);
+            myWatchdog->checkForStall();
+        }
+    }
+
+private:
+    StallWatchdog * myWatchdog;
+};
+
+StallWatchdog::StallWatchdog(QString logFileName, int stallThresholdMs, QObject *parent) : QObject(parent)
+{
+    myThreshold = qMax(HEARTBEAT_MS * 2, stallThresholdMs);
+    latencyBuckets.fill(0, LATENCY_BUCKET_COUNT);
+    markDepth.store(0);
+    currentEventType.store(QEvent::None);
+
+    logFile.setFileName(logFileName);
+
+    heartbeatTimer.setTimerType(Qt::PreciseTimer);
+    heartbeatTimer.setInterval(HEARTBEAT_MS);
+    QObject::connect(&heartbeatTimer, SIGNAL(timeout()), this, SLOT(heartbeatTick()));
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    if (activeWatchdog == this)
+    {
+        QCoreApplication::instance()->removeEventFilter(this);
+        activeWatchdog = nullptr;
+    }
+
+    if (monitorThread != nullptr)
+    {
+        monitorThread->requestInterruption();
+        monitorThread->wait();
+    }
+
+    if (clock.isValid())
+    {
+        writeLogLine(getHistogramText());
+    }
+}
+
+void StallWatchdog::start()
+{
+    if (monitorThread != nullptr) return;
+
+    if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        qCDebug(agaveAppLayer, "Unable to open stall log: %s", qPrintable(logFile.fileName()));
+    }
+    writeLogLine(QString("Stall watch started, threshold %1 ms").arg(myThreshold));
+
+    activeWatchdog = this;
+    QCoreApplication::instance()->installEventFilter(this);
+
+    clock.start();
+    lastHeartbeat.store(clock.elapsed());
+    heartbeatTimer.start();
+
+    monitorThread = new StallMonitorThread(this);
+    monitorThread->start(QThread::HighPriority);
+}
+
+QString StallWatchdog::getHistogramText()
+{
+    QString histogramText = "Event loop latency histogram:";
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        if (i < LATENCY_BUCKET_COUNT - 1)
+        {
+            histogramText.append(QString("\n  < %1 ms: %2").arg(LATENCY_BUCKET_LIMITS[i]).arg(latencyBuckets.at(i)));
+        }
+        else
+        {
+            histogramText.append(QString("\n  >= %1 ms: %2").arg(LATENCY_BUCKET_LIMITS[i - 1]).arg(latencyBuckets.at(i)));
+        }
+    }
+    histogramText.append(QString("\n  Longest: %1 ms, Stalls: %2").arg(longestLatency).arg(stallCount));
+    return histogramText;
+}
+
+StallWatchdog::HandlerMark::HandlerMark(const char * handlerName)
+{
+    if (activeWatchdog == nullptr) return;
+    if (QThread::currentThread() != activeWatchdog->thread()) return;
+
+    int depth = activeWatchdog->markDepth.load();
+    if (depth < MAX_MARK_DEPTH)
+    {
+        activeWatchdog->markStack[depth].store(handlerName);
+    }
+    activeWatchdog->markDepth.store(depth + 1);
+}
+
+StallWatchdog::HandlerMark::~HandlerMark()
+{
+    if (activeWatchdog == nullptr) return;
+    if (QThread::currentThread() != activeWatchdog->thread()) return;
+
+    int depth = activeWatchdog->markDepth.load();
+    if (depth > 0) activeWatchdog->markDepth.store(depth - 1);
+}
+
+bool StallWatchdog::eventFilter(QObject * watched, QEvent * event)
+{
+    //Only the class is kept, since the receiver itself may be deleted before the monitor looks at it
+    if (QThread::currentThread() == thread())
+    {
+        currentReceiver.store(watched->metaObject());
+        currentEventType.store(event->type());
+    }
+    return false;
+}
+
+void StallWatchdog::heartbeatTick()
+{
+    qint64 now = clock.elapsed();
+    qint64 latency = qMax((qint64) 0, now - lastHeartbeat.load() - HEARTBEAT_MS);
+    lastHeartbeat.store(now);
+
+    int bucket = 0;
+    while ((bucket < LATENCY_BUCKET_COUNT - 1) && (latency >= LATENCY_BUCKET_LIMITS[bucket]))
+    {
+        bucket++;
+    }
+    latencyBuckets[bucket]++;
+    if (latency > longestLatency) longestLatency = latency;
+
+    if (latency >= myThreshold)
+    {
+        stallCount++;
+        writeLogLine(QString("Stall ended after %1 ms").arg(latency + HEARTBEAT_MS));
+    }
+}
+
+QString StallWatchdog::describeRunningHandler()
+{
+    QStringList markNames;
+    int depth = qMin(markDepth.load(), (int) MAX_MARK_DEPTH);
+    for (int i = 0; i < depth; i++)
+    {
+        markNames.append(QString(markStack[i].load()));
+    }
+
+    const QMetaObject * receiverType = currentReceiver.load();
+    QString receiverName = (receiverType == nullptr) ? QString("unknown") : QString(receiverType->className());
+    int eventType = currentEventType.load();
+
+    QString eventText;
+    if (eventType == QEvent::MetaCall)
+    {
+        eventText = QString("queued slot call to %1").arg(receiverName);
+    }
+    else
+    {
+        eventText = QString("event type %1 to %2").arg(eventType).arg(receiverName);
+    }
+
+    if (markNames.isEmpty()) return eventText;
+    return QString("%1 (in %2)").arg(markNames.join(" > "), eventText);
+}
+
+void StallWatchdog::writeLogLine(QString logText)
+{
+    QMutexLocker lock(&logLock);
+    qCDebug(agaveAppLayer, "%s", qPrintable(logText));
+
+    if (!logFile.isOpen()) return;
+    logFile.write(QString("%1 %2\n").arg(QDateTime::currentDateTime().toString(Qt::ISODateWithMs), logText).toUtf8());
+    logFile.flush();
+}
+
+void StallWatchdog::checkForStall()
+{
+    //Runs on the monitor thread, so a stall is reported even if the GUI never recovers
+    qint64 heartbeat = lastHeartbeat.load();
+    qint64 stallLength = clock.elapsed() - heartbeat;
+    if (stallLength < myThreshold) return;
+    if (stallStartReported == heartbeat) return;
+    stallStartReported = heartbeat;
+
+    writeLogLine(QString("GUI stalled for %1 ms, running: %2").arg(stallLength).arg(describeRunningHandler()));
+}
@@ -0,0 +1,115 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QFile>
+#include <QVector>
+
+class QEvent;
+
+/*! \brief The StallWatchdog measures how long events wait on the GUI thread, and logs what was running when the GUI stalls.
+ *
+ *  A heartbeat timer on the GUI thread records how late each tick arrives into a histogram of event-loop latency.
+ *  A monitor thread watches the heartbeat. If it stops for longer than the stall threshold, the monitor writes the handler running on the GUI thread to the log file, without waiting for the stall to end.
+ *  When the stall ends, its full length is logged as well.
+ *
+ *  The running handler is known from the event being delivered, and from any HandlerMark placed in slow slots.
+ */
+
+class StallWatchdog : public QObject
+{
+    Q_OBJECT
+
+    friend class StallMonitorThread;
+
+public:
+    explicit StallWatchdog(QString logFileName, int stallThresholdMs = 250, QObject *parent = nullptr);
+    ~StallWatchdog();
+
+    void start();
+    QString getHistogramText();
+
+    /*! \brief A HandlerMark names the code running on the GUI thread for as long as it is in scope. Names must be string literals. */
+    class HandlerMark
+    {
+    public:
+        explicit HandlerMark(const char * handlerName);
+        ~HandlerMark();
+    };
+
+protected:
+    bool eventFilter(QObject * watched, QEvent * event);
+
+private slots:
+    void heartbeatTick();
+
+private:
+    QString describeRunningHandler();
+    void writeLogLine(QString logText);
+    void checkForStall();
+
+    static StallWatchdog * activeWatchdog;
+    static const int MAX_MARK_DEPTH = 16;
+    static const int HEARTBEAT_MS = 50;
+
+    QTimer heartbeatTimer;
+    QElapsedTimer clock;
+    QAtomicInteger<qint64> lastHeartbeat;
+    qint64 stallStartReported = -1;
+    int myThreshold;
+
+    QAtomicPointer<const QMetaObject> currentReceiver;
+    QAtomicInt currentEventType;
+    QAtomicPointer<const char> markStack[MAX_MARK_DEPTH];
+    QAtomicInt markDepth;
+
+    QVector<qint64> latencyBuckets;
+    qint64 longestLatency = 0;
+    int stallCount = 0;
+
+    QMutex logLock;
+    QFile logFile;
+    QThread * monitorThread = nullptr;
+};
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,221 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "streamchecksum.h"
+
+#include <QtEndian>
+
+#include <string.h>
+
+//The constants and steps of XXH64, as given in the xxHash specification
+static const quint64 XXH_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const quint64 XXH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const quint64 XXH_PRIME3 = 0x165667B19E3779F9ULL;
+static const quint64 XXH_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const quint64 XXH_PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static inline quint64 xxhRotate(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline quint64 xxhRead64(const uchar * data)
+{
+    return qFromLittleEndian<quint64>(data);
+}
+
+static inline quint64 xxhRound(quint64 accumulator, quint64 input)
+{
+    accumulator += input * XXH_PRIME2;
+    accumulator = xxhRotate(accumulator, 31);
+    return accumulator * XXH_PRIME1;
+}
+
+static inline quint64 xxhMergeRound(quint64 accumulator, quint64 value)
+{
+    accumulator ^= xxhRound(0, value);
+    return accumulator * XXH_PRIME1 + XXH_PRIME4;
+}
+
+StreamChecksum::StreamChecksum(ChecksumType type) : md5Hash(QCryptographicHash::Md5)
+{
+    myType = type;
+
+    xxhState[0] = XXH_PRIME1 + XXH_PRIME2;
+    xxhState[1] = XXH_PRIME2;
+    xxhState[2] = 0;
+    xxhState[3] = 0 - XXH_PRIME1;
+}
+
+void StreamChecksum::addData(const char * data, qint64 length)
+{
+    if (length <= 0) return;
+
+    if (myType == ChecksumType::MD5)
+    {
+        totalLength += length;
+        while (length > 0)
+        {
+            int chunkLength = (int) qMin(length, (qint64) (1 << 30));
+            md5Hash.addData(data, chunkLength);
+            data += chunkLength;
+            length -= chunkLength;
+        }
+        return;
+    }
+    xxhAddData((const uchar *) data, length);
+}
+
+void StreamChecksum::addData(const QByteArray &data)
+{
+    addData(data.constData(), data.size());
+}
+
+QString StreamChecksum::getResult()
+{
+    if (myType == ChecksumType::MD5)
+    {
+        return QString("md5:%1").arg(QString::fromLatin1(md5Hash.result().toHex()));
+    }
+    return QString("xxh64:%1").arg(xxhResult(), 16, 16, QChar('0'));
+}
+
+qint64 StreamChecksum::getLength()
+{
+    return totalLength;
+}
+
+bool StreamChecksum::resultsMatch(QString checksum1, QString checksum2)
+{
+    //A server checksum may lack the type prefix
+    QString hex1 = checksum1.section(':', -1).trimmed();
+    QString hex2 = checksum2.section(':', -1).trimmed();
+    return (hex1.compare(hex2, Qt::CaseInsensitive) == 0);
+}
+
+void StreamChecksum::xxhAddData(const uchar * data, qint64 length)
+{
+    totalLength += length;
+
+    if (xxhBuffered > 0)
+    {
+        int fillBytes = (int) qMin(length, (qint64) (32 - xxhBuffered));
+        memcpy(xxhBuffer + xxhBuffered, data, fillBytes);
+        xxhBuffered += fillBytes;
+        data += fillBytes;
+        length -= fillBytes;
+        if (xxhBuffered < 32) return;
+
+        for (int i = 0; i < 4; i++)
+        {
+            xxhState[i] = xxhRound(xxhState[i], xxhRead64(xxhBuffer + 8 * i));
+        }
+        xxhBuffered = 0;
+    }
+
+    //The four lanes are independent, which lets the compiler overlap them
+    quint64 lane0 = xxhState[0];
+    quint64 lane1 = xxhState[1];
+    quint64 lane2 = xxhState[2];
+    quint64 lane3 = xxhState[3];
+    while (length >= 32)
+    {
+        lane0 = xxhRound(lane0, xxhRead64(data));
+        lane1 = xxhRound(lane1, xxhRead64(data + 8));
+        lane2 = xxhRound(lane2, xxhRead64(data + 16));
+        lane3 = xxhRound(lane3, xxhRead64(data + 24));
+        data += 32;
+        length -= 32;
+    }
+    xxhState[0] = lane0;
+    xxhState[1] = lane1;
+    xxhState[2] = lane2;
+    xxhState[3] = lane3;
+
+    if (length > 0)
+    {
+        memcpy(xxhBuffer, data, length);
+        xxhBuffered = (int) length;
+    }
+}
+
+quint64 StreamChecksum::xxhResult()
+{
+    quint64 hashValue;
+    if (totalLength >= 32)
+    {
+        hashValue = xxhRotate(xxhState[0], 1) + xxhRotate(xxhState[1], 7) + xxhRotate(xxhState[2], 12) + xxhRotate(xxhState[3], 18);
+        for (int i = 0; i < 4; i++)
+        {
+            hashValue = xxhMergeRound(hashValue, xxhState[i]);
+        }
+    }
+    else
+    {
+        hashValue = xxhState[2] + XXH_PRIME5;
+    }
+    hashValue += (quint64) totalLength;
+
+    const uchar * tailData = xxhBuffer;
+    int tailLength = xxhBuffered;
+    while (tailLength >= 8)
+    {
+        hashValue ^= xxhRound(0, xxhRead64(tailData));
+        hashValue = xxhRotate(hashValue, 27) * XXH_PRIME1 + XXH_PRIME4;
+        tailData += 8;
+        tailLength -= 8;
+    }
+    if (tailLength >= 4)
+    {
+        hashValue ^= ((quint64) qFromLittleEndian<quint32>(tailData)) * XXH_PRIME1;
+        hashValue = xxhRotate(hashValue, 23) * XXH_PRIME2 + XXH_PRIME3;
+        tailData += 4;
+        tailLength -= 4;
+    }
+    while (tailLength > 0)
+    {
+        hashValue ^= (*tailData) * XXH_PRIME5;
+        hashValue = xxhRotate(hashValue, 11) * XXH_PRIME1;
+        tailData++;
+        tailLength--;
+    }
+
+    hashValue ^= hashValue >> 33;
+    hashValue *= XXH_PRIME2;
+    hashValue ^= hashValue >> 29;
+    hashValue *= XXH_PRIME3;
+    hashValue ^= hashValue >> 32;
+    return hashValue;
+}
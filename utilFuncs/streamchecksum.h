@@ -0,0 +1,78 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef STREAMCHECKSUM_H
+#define STREAMCHECKSUM_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+
+enum class ChecksumType {XXH64, MD5};
+
+/*! \brief The StreamChecksum computes a checksum of transfer data a piece at a time, as the data passes through.
+ *
+ *  Give each piece of data to addData() as it is read or written, and the checksum is ready when the transfer ends, without reading the file again.
+ *  XXH64 is the default, as it is far faster than a cryptographic hash. MD5 is offered for comparing against checksums reported by the server.
+ *
+ *  getResult() gives the checksum in hex, prefixed by its type, for example: "xxh64:44bc2cf5ad770999"
+ */
+
+class StreamChecksum
+{
+public:
+    explicit StreamChecksum(ChecksumType type = ChecksumType::XXH64);
+
+    void addData(const char * data, qint64 length);
+    void addData(const QByteArray &data);
+
+    QString getResult();
+    qint64 getLength();
+
+    static bool resultsMatch(QString checksum1, QString checksum2);
+
+private:
+    void xxhAddData(const uchar * data, qint64 length);
+    quint64 xxhResult();
+
+    ChecksumType myType;
+    QCryptographicHash md5Hash;
+
+    quint64 xxhState[4];
+    uchar xxhBuffer[32];
+    int xxhBuffered = 0;
+    qint64 totalLength = 0;
+};
+
+#endif // STREAMCHECKSUM_H
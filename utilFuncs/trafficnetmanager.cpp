@@ -0,0 +1,794 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "trafficnetmanager.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+#include "coalescedrequest.h"
+#include "httpresponsecache.h"
+#include "ae_globals.h"
+
+static const quint32 TRAFFIC_FILE_MAGIC = 0x41455452;
+static const quint32 TRAFFIC_FILE_VERSION = 1;
+static const quint32 TICKET_FILE_MAGIC = 0x41455453;
+static const int KEEP_WARM_INTERVAL_MS = 60000;
+
+static QDataStream &operator<<(QDataStream &out, const TrafficRecord &aRecord)
+{
+    out << aRecord.requestKey << aRecord.startOffset << aRecord.elapsedTime;
+    out << (qint32) aRecord.networkError << aRecord.errorText;
+    out << (qint32) aRecord.httpStatus << aRecord.httpReason;
+
+    out << (qint32) aRecord.headers.size();
+    for (const QNetworkReply::RawHeaderPair &aHeader : aRecord.headers)
+    {
+        out << aHeader.first << aHeader.second;
+    }
+    out << qCompress(aRecord.body);
+    return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, TrafficRecord &aRecord)
+{
+    qint32 networkError;
+    qint32 httpStatus;
+    qint32 headerCount;
+
+    in >> aRecord.requestKey >> aRecord.startOffset >> aRecord.elapsedTime;
+    in >> networkError >> aRecord.errorText;
+    in >> httpStatus >> aRecord.httpReason;
+    aRecord.networkError = networkError;
+    aRecord.httpStatus = httpStatus;
+
+    in >> headerCount;
+    aRecord.headers.clear();
+    for (qint32 i = 0; (i < headerCount) && (in.status() == QDataStream::Ok); i++)
+    {
+        QNetworkReply::RawHeaderPair aHeader;
+        in >> aHeader.first >> aHeader.second;
+        aRecord.headers.append(aHeader);
+    }
+
+    QByteArray compressedBody;
+    in >> compressedBody;
+    aRecord.body = qUncompress(compressedBody);
+    return in;
+}
+
+TrafficNetManager::TrafficNetManager(TrafficMode mode, QString trafficFileName, double speed, QObject *parent) :
+    QNetworkAccessManager(parent), trafficFile(trafficFileName, this)
+{
+    myMode = mode;
+    replaySpeed = speed;
+    sessionTimer.start();
+
+
+    keepWarmTimer.setParent(this);
+    keepWarmTimer.setInterval(KEEP_WARM_INTERVAL_MS);
+    QObject::connect(&keepWarmTimer, SIGNAL(timeout()), this, SLOT(keepConnectionsWarm()));
+
+    if (myMode == TrafficMode::RECORD)
+    {
+        if (!trafficFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            ae_globals::displayFatalPopup(QString("Unable to open traffic file for recording: %1").arg(trafficFileName));
+        }
+        //Reply bodies hold the user's files and job data
+        trafficFile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+        QDataStream fileStream(&trafficFile);
+        fileStream << TRAFFIC_FILE_MAGIC << TRAFFIC_FILE_VERSION;
+        qCDebug(agaveAppLayer, "Recording network traffic to: %s", qPrintable(trafficFileName));
+    }
+    else if (myMode == TrafficMode::REPLAY)
+    {
+        if (!loadTrafficFile())
+        {
+            ae_globals::displayFatalPopup(QString("Unable to load traffic file for replay: %1").arg(trafficFileName));
+        }
+        qCDebug(agaveAppLayer, "Replaying network traffic from: %s", qPrintable(trafficFileName));
+    }
+}
+
+TrafficNetManager::~TrafficNetManager()
+{
+    if (trafficFile.isOpen())
+    {
+        trafficFile.close();
+    }
+}
+
+TrafficMode TrafficNetManager::getMode()
+{
+    return myMode;
+}
+
+void TrafficNetManager::storeRecord(TrafficRecord newRecord)
+{
+    if ((myMode != TrafficMode::RECORD) || !trafficFile.isOpen()) return;
+
+    //Records are written as they finish, so that a session cut short still leaves a usable file
+    QDataStream fileStream(&trafficFile);
+    fileStream << newRecord;
+    trafficFile.flush();
+}
+
+qint64 TrafficNetManager::getSessionTime()
+{
+    return sessionTimer.elapsed();
+}
+
+QString TrafficNetManager::getRequestKey(Operation op, const QNetworkRequest &req)
+{
+    QString verb;
+    switch (op)
+    {
+    case HeadOperation: verb = "HEAD"; break;
+    case GetOperation: verb = "GET"; break;
+    case PutOperation: verb = "PUT"; break;
+    case PostOperation: verb = "POST"; break;
+    case DeleteOperation: verb = "DELETE"; break;
+    case CustomOperation: verb = req.attribute(QNetworkRequest::CustomVerbAttribute).toString(); break;
+    default: verb = "UNKNOWN"; break;
+    }
+    return QString("%1 %2").arg(verb, req.url().toString());
+}
+
+void TrafficNetManager::setReadCoalescing(bool enabled)
+{
+    coalesceReads = enabled;
+}
+
+void TrafficNetManager::releaseCoalescedRead(QString coalesceKey, CoalescedRequest * finishedRead)
+{
+    if (inFlightReads.value(coalesceKey, nullptr) == finishedRead)
+    {
+        inFlightReads.remove(coalesceKey);
+    }
+}
+
+int TrafficNetManager::getReadRequestCount()
+{
+    return readRequestCount.load();
+}
+
+int TrafficNetManager::getCoalescedReadCount()
+{
+    return coalescedReadCount.load();
+}
+
+void TrafficNetManager::abortBulkTransfers()
+{
+    QList<QPointer<QNetworkReply>> toAbort = bulkTransfers;
+    bulkTransfers.clear();
+
+    for (QPointer<QNetworkReply> aTransfer : toAbort)
+    {
+        if (!aTransfer.isNull() && !aTransfer->isFinished())
+        {
+            qCDebug(agaveAppLayer, "Aborting transfer: %s", qPrintable(aTransfer->url().toString()));
+            aTransfer->abort();
+        }
+    }
+}
+
+int TrafficNetManager::getRequestCount()
+{
+    return requestCount.load();
+}
+
+qint64 TrafficNetManager::getBytesReceived()
+{
+    return bytesReceived.load();
+}
+
+void TrafficNetManager::sourceReplyFinished()
+{
+    requestCount.ref();
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    if (theReply == nullptr) return;
+
+    //Cache attributes are only set on the reply which went to the cache, not on copies made for coalesced callers
+    if ((responseCache != nullptr) && (theReply->operation() == GetOperation))
+    {
+        cacheableReadCount.ref();
+        if (theReply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool())
+        {
+            cacheHitCount.ref();
+            if (theReply->request().attribute(QNetworkRequest::CacheLoadControlAttribute).toInt() == QNetworkRequest::PreferCache)
+            {
+                cacheOnlyCount.ref();
+            }
+        }
+    }
+
+    //Servers may send a new ticket after the handshake, so the latest one is kept
+    if (theReply->url().scheme() == "https")
+    {
+        saveSessionTicket(theReply->sslConfiguration());
+    }
+}
+
+void TrafficNetManager::countReceivedBytes(qint64 replyBytes, qint64)
+{
+    //Progress is cumulative, so only the growth since the last report is added
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    if (theReply == nullptr) return;
+
+    qint64 countedBytes = theReply->property("bytesCounted").toLongLong();
+    if (replyBytes <= countedBytes) return;
+
+    bytesReceived.fetchAndAddRelaxed(replyBytes - countedBytes);
+    theReply->setProperty("bytesCounted", replyBytes);
+}
+
+void TrafficNetManager::setServiceBase(QString serviceBase)
+{
+    QMutexLocker lock(&authLock);
+    myServiceBase = serviceBase;
+}
+
+bool TrafficNetManager::signServiceRequest(QNetworkRequest &theRequest, QString servicePath)
+{
+    QMutexLocker lock(&authLock);
+    if (myServiceBase.isEmpty()) return false;
+
+    //Replayed replies are matched by URL alone, so they need no token
+    if (accessToken.isEmpty() && (myMode != TrafficMode::REPLAY)) return false;
+
+    QUrl serviceUrl(myServiceBase);
+    serviceUrl.setPath(serviceUrl.path() + servicePath);
+    theRequest.setUrl(serviceUrl);
+    if (!accessToken.isEmpty())
+    {
+        theRequest.setRawHeader("Authorization", QByteArray("Bearer ").append(accessToken));
+    }
+    return true;
+}
+
+bool TrafficNetManager::isTokenGrant(Operation op, const QUrl &theUrl)
+{
+    //Both the first login and each refresh get their token here
+    return (op == PostOperation) && theUrl.path().endsWith("/token");
+}
+
+void TrafficNetManager::takeTokenGrant(const TrafficRecord &grantRecord)
+{
+    if ((grantRecord.networkError != QNetworkReply::NoError) || (grantRecord.httpStatus != 200)) return;
+
+    QByteArray newToken = QJsonDocument::fromJson(grantRecord.body).object().value("access_token").toString().toLatin1();
+    if (newToken.isEmpty()) return;
+
+    QMutexLocker lock(&authLock);
+    accessToken = newToken;
+}
+
+TrafficRecord TrafficNetManager::redactTokenGrant(TrafficRecord grantRecord)
+{
+    QJsonObject grantObject = QJsonDocument::fromJson(grantRecord.body).object();
+    if (grantObject.isEmpty()) return grantRecord;
+
+    for (QString tokenKey : {"access_token", "refresh_token"})
+    {
+        if (grantObject.contains(tokenKey)) grantObject.insert(tokenKey, QString("redacted"));
+    }
+    grantRecord.body = QJsonDocument(grantObject).toJson(QJsonDocument::Compact);
+
+    //The body length has changed
+    for (QNetworkReply::RawHeaderPair &aHeader : grantRecord.headers)
+    {
+        if (aHeader.first.toLower() == "content-length") aHeader.second = QByteArray::number(grantRecord.body.size());
+    }
+    return grantRecord;
+}
+
+void TrafficNetManager::enableResponseCache(QString cacheFolder, qint64 maxBytes)
+{
+    //Replayed replies never touch the network, so there is nothing to cache
+    if ((myMode == TrafficMode::REPLAY) || (maxBytes <= 0)) return;
+
+    responseCache = new HttpResponseCache(cacheFolder, maxBytes);
+    setCache(responseCache);
+}
+
+int TrafficNetManager::getCacheableReadCount()
+{
+    return cacheableReadCount.load();
+}
+
+int TrafficNetManager::getCacheHitCount()
+{
+    return cacheHitCount.load();
+}
+
+int TrafficNetManager::getCacheOnlyCount()
+{
+    return cacheOnlyCount.load();
+}
+
+int TrafficNetManager::getHandshakeCount()
+{
+    return handshakeCount.load();
+}
+
+int TrafficNetManager::getResumeOfferCount()
+{
+    return resumeOfferCount.load();
+}
+
+qint64 TrafficNetManager::getHandshakeTotalTime()
+{
+    return handshakeTotalTime.load();
+}
+
+void TrafficNetManager::prewarmConnections(QString serviceBase, int connectionCount, QString ticketFile)
+{
+    if (myMode == TrafficMode::REPLAY) return;
+    if (connectionCount <= 0) return;
+
+    warmServiceUrl = QUrl(serviceBase);
+    warmConnectionCount = connectionCount;
+    ticketFileName = ticketFile;
+
+    //The default configuration is used by every request, so they all offer the saved ticket
+    loadSessionTicket();
+    QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
+    sslConfig.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    if (!savedTicket.isEmpty())
+    {
+        sslConfig.setSessionTicket(savedTicket);
+    }
+    QSslConfiguration::setDefaultConfiguration(sslConfig);
+
+    keepConnectionsWarm();
+    keepWarmTimer.start();
+}
+
+void TrafficNetManager::keepConnectionsWarm()
+{
+    //Each pre-connect takes its own connection, so these must not be coalesced as duplicate reads
+    prewarmUnderway = true;
+    for (int i = 0; i < warmConnectionCount; i++)
+    {
+        connectToHostEncrypted(warmServiceUrl.host(), warmServiceUrl.port(443), QSslConfiguration::defaultConfiguration());
+    }
+    prewarmUnderway = false;
+}
+
+void TrafficNetManager::connectionEncrypted()
+{
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    if ((theReply == nullptr) || !theReply->property("requestStart").isValid()) return;
+
+    qint64 handshakeTime = sessionTimer.elapsed() - theReply->property("requestStart").toLongLong();
+    bool ticketOffered = theReply->property("ticketOffered").toBool();
+
+    handshakeCount.ref();
+    handshakeTotalTime.fetchAndAddRelaxed(handshakeTime);
+    if (ticketOffered) resumeOfferCount.ref();
+
+    qCDebug(agaveAppLayer, "TLS ready for %s after %lld ms, %s", qPrintable(theReply->url().host()), handshakeTime,
+            ticketOffered ? "resuming saved session" : "full handshake");
+
+    saveSessionTicket(theReply->sslConfiguration());
+}
+
+void TrafficNetManager::loadSessionTicket()
+{
+    savedTicket.clear();
+    QFile ticketFile(ticketFileName);
+    if (!ticketFile.open(QIODevice::ReadOnly)) return;
+
+    QDataStream fileStream(&ticketFile);
+    quint32 fileMagic;
+    QString ticketHost;
+    QByteArray ticketData;
+    qint64 expiryTime;
+    fileStream >> fileMagic >> ticketHost >> ticketData >> expiryTime;
+
+    if ((fileStream.status() != QDataStream::Ok) || (fileMagic != TICKET_FILE_MAGIC)) return;
+    if (ticketHost != warmServiceUrl.host()) return;
+    if (expiryTime <= QDateTime::currentMSecsSinceEpoch()) return;
+
+    savedTicket = ticketData;
+}
+
+void TrafficNetManager::saveSessionTicket(const QSslConfiguration &sslConfig)
+{
+    QByteArray newTicket = sslConfig.sessionTicket();
+    if (ticketFileName.isEmpty() || newTicket.isEmpty() || (newTicket == savedTicket)) return;
+    savedTicket = newTicket;
+
+    QFile ticketFile(ticketFileName);
+    if (!ticketFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCDebug(agaveAppLayer, "Unable to save TLS session: %s", qPrintable(ticketFileName));
+        return;
+    }
+    //The ticket lets anyone resume this session, so it is kept private to the user
+    ticketFile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    qint64 expiryTime = QDateTime::currentMSecsSinceEpoch() + ((qint64) sslConfig.sessionTicketLifeTimeHint()) * 1000;
+    QDataStream fileStream(&ticketFile);
+    fileStream << TICKET_FILE_MAGIC << warmServiceUrl.host() << newTicket << expiryTime;
+}
+
+QNetworkReply * TrafficNetManager::createRequest(Operation op, const QNetworkRequest &req, QIODevice *outgoingData)
+{
+    if (prewarmUnderway)
+    {
+        return createNetworkReply(op, req, outgoingData);
+    }
+
+    //A job which has ended will not change, so its details need no revalidation
+    QNetworkRequest theRequest(req);
+    if ((responseCache != nullptr) && (op == GetOperation) && HttpResponseCache::isJobDetailUrl(req.url()))
+    {
+        if (responseCache->holdsTerminalJob(req.url()))
+        {
+            theRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+        }
+    }
+    //File contents would only push metadata out of the cache
+    if (req.url().path().contains("/media/"))
+    {
+        theRequest.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+    }
+
+    QNetworkReply * newReply = createCoalescedReply(op, theRequest, outgoingData);
+
+    //File contents, in either direction, go through the media endpoint
+    if (req.url().path().contains("/media/"))
+    {
+        bulkTransfers.removeAll(QPointer<QNetworkReply>());
+        bulkTransfers.append(newReply);
+    }
+    return newReply;
+}
+
+QNetworkReply * TrafficNetManager::createCoalescedReply(Operation op, const QNetworkRequest &req, QIODevice *outgoingData)
+{
+    //A range read only matches another read of the same range
+    if (!coalesceReads || (op != GetOperation) || req.hasRawHeader("Range"))
+    {
+        return createSourceReply(op, req, outgoingData);
+    }
+
+    //Different credentials must never share a reply
+    QString coalesceKey = getRequestKey(op, req);
+    coalesceKey.append(' ');
+    coalesceKey.append(QString::fromLatin1(req.rawHeader("Authorization")));
+
+    readRequestCount.ref();
+    CoalescedRequest * inFlightRead = inFlightReads.value(coalesceKey, nullptr);
+    if ((inFlightRead != nullptr) && inFlightRead->acceptingWaiters())
+    {
+        coalescedReadCount.ref();
+        qCDebug(agaveAppLayer, "Coalesced duplicate read: %s", qPrintable(req.url().toString()));
+        return inFlightRead->addWaiter(op, req);
+    }
+
+    inFlightRead = new CoalescedRequest(createSourceReply(op, req, outgoingData), coalesceKey, this);
+    inFlightReads.insert(coalesceKey, inFlightRead);
+    return inFlightRead->addWaiter(op, req);
+}
+
+QNetworkReply * TrafficNetManager::createSourceReply(Operation op, const QNetworkRequest &req, QIODevice *outgoingData)
+{
+    if (myMode == TrafficMode::REPLAY)
+    {
+        QString requestKey = getRequestKey(op, req);
+        TrafficRecord theRecord;
+
+        if (replayRecords.contains(requestKey) && !replayRecords[requestKey].isEmpty())
+        {
+            theRecord = replayRecords[requestKey].dequeue();
+        }
+        else
+        {
+            qCDebug(agaveAppLayer, "No recorded reply for: %s", qPrintable(requestKey));
+            theRecord.requestKey = requestKey;
+            theRecord.networkError = QNetworkReply::ContentNotFoundError;
+            theRecord.errorText = "No recorded reply for this request.";
+        }
+
+        int delay = 0;
+        if (replaySpeed > 0)
+        {
+            delay = (int) (theRecord.elapsedTime / replaySpeed);
+        }
+        TrafficReplayReply * replayReply = new TrafficReplayReply(op, req, theRecord, delay, this);
+        trackSourceReply(replayReply);
+        return replayReply;
+    }
+
+    //Token grants are always read through a record reply, so that the access token can be taken from them
+    QNetworkReply * realReply = createNetworkReply(op, req, outgoingData);
+    if ((myMode == TrafficMode::RECORD) || isTokenGrant(op, req.url()))
+    {
+        return new TrafficRecordReply(realReply, getRequestKey(op, req), this);
+    }
+    return realReply;
+}
+
+QNetworkReply * TrafficNetManager::createNetworkReply(Operation op, const QNetworkRequest &req, QIODevice *outgoingData)
+{
+    QNetworkReply * newReply = QNetworkAccessManager::createRequest(op, req, outgoingData);
+    if (!prewarmUnderway)
+    {
+        trackSourceReply(newReply);
+    }
+
+    //Only the real reply reports encrypted(), since wrappers around it are the ones handed to callers
+    //Pre-connects use their own scheme name, but are the same TLS handshake
+    if ((req.url().scheme() == "https") || (req.url().scheme() == "preconnect-https"))
+    {
+        newReply->setProperty("requestStart", sessionTimer.elapsed());
+        newReply->setProperty("ticketOffered", !req.sslConfiguration().sessionTicket().isEmpty());
+        QObject::connect(newReply, SIGNAL(encrypted()), this, SLOT(connectionEncrypted()));
+    }
+    return newReply;
+}
+
+void TrafficNetManager::trackSourceReply(QNetworkReply * sourceReply)
+{
+    //Requests and bytes are counted once per source reply, however many callers share it, and whatever the framing of the body
+    QObject::connect(sourceReply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(countReceivedBytes(qint64,qint64)));
+    QObject::connect(sourceReply, SIGNAL(finished()), this, SLOT(sourceReplyFinished()));
+}
+
+bool TrafficNetManager::loadTrafficFile()
+{
+    if (!trafficFile.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream fileStream(&trafficFile);
+    quint32 magic;
+    quint32 version;
+    fileStream >> magic >> version;
+    if ((magic != TRAFFIC_FILE_MAGIC) || (version != TRAFFIC_FILE_VERSION))
+    {
+        trafficFile.close();
+        return false;
+    }
+
+    int recordCount = 0;
+    while (!fileStream.atEnd())
+    {
+        TrafficRecord aRecord;
+        fileStream >> aRecord;
+        if (fileStream.status() != QDataStream::Ok) break;
+
+        replayRecords[aRecord.requestKey].enqueue(aRecord);
+        recordCount++;
+    }
+    trafficFile.close();
+
+    qCDebug(agaveAppLayer, "Loaded %d recorded replies.", recordCount);
+    return true;
+}
+
+TrafficRecordReply::TrafficRecordReply(QNetworkReply * realReply, QString requestKey, TrafficNetManager * manager) :
+    QNetworkReply(manager)
+{
+    myRealReply = realReply;
+    myRealReply->setParent(this);
+    myManager = manager;
+
+    myRecord.requestKey = requestKey;
+    myRecord.startOffset = myManager->getSessionTime();
+    replyTimer.start();
+
+    setOperation(myRealReply->operation());
+    setRequest(myRealReply->request());
+    setUrl(myRealReply->url());
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    QObject::connect(myRealReply, SIGNAL(metaDataChanged()), this, SLOT(realMetaDataChanged()));
+    QObject::connect(myRealReply, SIGNAL(readyRead()), this, SLOT(realDataReady()));
+    QObject::connect(myRealReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(realError(QNetworkReply::NetworkError)));
+    QObject::connect(myRealReply, SIGNAL(finished()), this, SLOT(realFinished()));
+
+    QObject::connect(myRealReply, SIGNAL(uploadProgress(qint64,qint64)), this, SIGNAL(uploadProgress(qint64,qint64)));
+    QObject::connect(myRealReply, SIGNAL(downloadProgress(qint64,qint64)), this, SIGNAL(downloadProgress(qint64,qint64)));
+    QObject::connect(myRealReply, SIGNAL(sslErrors(QList<QSslError>)), this, SIGNAL(sslErrors(QList<QSslError>)));
+}
+
+TrafficRecordReply::~TrafficRecordReply() {}
+
+void TrafficRecordReply::abort()
+{
+    myRealReply->abort();
+}
+
+void TrafficRecordReply::ignoreSslErrors()
+{
+    myRealReply->ignoreSslErrors();
+}
+
+qint64 TrafficRecordReply::bytesAvailable() const
+{
+    return pendingData.size() + QIODevice::bytesAvailable();
+}
+
+bool TrafficRecordReply::isSequential() const
+{
+    return true;
+}
+
+qint64 TrafficRecordReply::readData(char *data, qint64 maxSize)
+{
+    qint64 readSize = qMin(maxSize, (qint64) pendingData.size());
+    memcpy(data, pendingData.constData(), readSize);
+    pendingData.remove(0, readSize);
+    return readSize;
+}
+
+void TrafficRecordReply::realMetaDataChanged()
+{
+    myRecord.httpStatus = myRealReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    myRecord.httpReason = myRealReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toByteArray();
+    myRecord.headers = myRealReply->rawHeaderPairs();
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, myRealReply->attribute(QNetworkRequest::HttpStatusCodeAttribute));
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, myRealReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    setAttribute(QNetworkRequest::RedirectionTargetAttribute, myRealReply->attribute(QNetworkRequest::RedirectionTargetAttribute));
+    for (const QNetworkReply::RawHeaderPair &aHeader : myRecord.headers)
+    {
+        setRawHeader(aHeader.first, aHeader.second);
+    }
+    emit metaDataChanged();
+}
+
+void TrafficRecordReply::realDataReady()
+{
+    QByteArray newData = myRealReply->readAll();
+    if (newData.isEmpty()) return;
+
+    pendingData.append(newData);
+    myRecord.body.append(newData);
+    emit readyRead();
+}
+
+void TrafficRecordReply::realError(QNetworkReply::NetworkError errorCode)
+{
+    myRecord.networkError = errorCode;
+    myRecord.errorText = myRealReply->errorString();
+
+    setError(errorCode, myRecord.errorText);
+    emit error(errorCode);
+}
+
+void TrafficRecordReply::realFinished()
+{
+    if (myRealReply->bytesAvailable() > 0)
+    {
+        realDataReady();
+    }
+
+    myRecord.elapsedTime = replyTimer.elapsed();
+    if (TrafficNetManager::isTokenGrant(operation(), url()))
+    {
+        myManager->takeTokenGrant(myRecord);
+        myManager->storeRecord(TrafficNetManager::redactTokenGrant(myRecord));
+    }
+    else
+    {
+        myManager->storeRecord(myRecord);
+    }
+
+    setFinished(true);
+    emit finished();
+}
+
+TrafficReplayReply::TrafficReplayReply(Operation op, const QNetworkRequest &req, TrafficRecord theRecord, int delay, QObject *parent) :
+    QNetworkReply(parent)
+{
+    myRecord = theRecord;
+
+    setOperation(op);
+    setRequest(req);
+    setUrl(req.url());
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    //Delivery is always deferred, so that the caller can connect to this reply first
+    QTimer::singleShot(delay, this, SLOT(deliverReply()));
+}
+
+void TrafficReplayReply::abort()
+{
+    if (delivered) return;
+    delivered = true;
+
+    setError(QNetworkReply::OperationCanceledError, "Operation canceled");
+    emit error(QNetworkReply::OperationCanceledError);
+    setFinished(true);
+    emit finished();
+}
+
+qint64 TrafficReplayReply::bytesAvailable() const
+{
+    return pendingData.size() + QIODevice::bytesAvailable();
+}
+
+bool TrafficReplayReply::isSequential() const
+{
+    return true;
+}
+
+qint64 TrafficReplayReply::readData(char *data, qint64 maxSize)
+{
+    qint64 readSize = qMin(maxSize, (qint64) pendingData.size());
+    memcpy(data, pendingData.constData(), readSize);
+    pendingData.remove(0, readSize);
+    return readSize;
+}
+
+void TrafficReplayReply::deliverReply()
+{
+    if (delivered) return;
+    delivered = true;
+
+    if (myRecord.httpStatus != 0)
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, myRecord.httpStatus);
+        setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, myRecord.httpReason);
+    }
+    for (const QNetworkReply::RawHeaderPair &aHeader : myRecord.headers)
+    {
+        setRawHeader(aHeader.first, aHeader.second);
+    }
+    emit metaDataChanged();
+
+    pendingData = myRecord.body;
+    if (!pendingData.isEmpty())
+    {
+        emit downloadProgress(pendingData.size(), pendingData.size());
+        emit readyRead();
+    }
+
+    if (myRecord.networkError != QNetworkReply::NoError)
+    {
+        QNetworkReply::NetworkError errorCode = static_cast<QNetworkReply::NetworkError>(myRecord.networkError);
+        setError(errorCode, myRecord.errorText);
+        emit error(errorCode);
+    }
+
+    setFinished(true);
+    emit finished();
+}
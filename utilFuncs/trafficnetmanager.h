@@ -0,0 +1,252 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef TRAFFICNETMANAGER_H
+#define TRAFFICNETMANAGER_H
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QQueue>
+#include <QAtomicInt>
+#include <QPointer>
+#include <QMutex>
+#include <QSslConfiguration>
+#include <QTimer>
+
+class CoalescedRequest;
+class HttpResponseCache;
+
+enum class TrafficMode {PASSTHROUGH, RECORD, REPLAY};
+
+/*! \brief A TrafficRecord is one request/response pair, as captured by the TrafficNetManager.
+ */
+
+struct TrafficRecord
+{
+    QString requestKey;
+    qint64 startOffset = 0;
+    qint64 elapsedTime = 0;
+
+    int networkError = 0;
+    QString errorText;
+    int httpStatus = 0;
+    QByteArray httpReason;
+    QList<QNetworkReply::RawHeaderPair> headers;
+    QByteArray body;
+};
+
+/*! \brief The TrafficNetManager is a QNetworkAccessManager which can record or replay HTTP traffic.
+ *
+ *  In RECORD mode, all requests go to the network as usual, but each reply is copied, with its timing, to a traffic file.
+ *  In REPLAY mode, no network access is made. Replies are served from a traffic file, after the recorded delay divided by the replay speed. A replay speed of 0 serves replies immediately.
+ *
+ *  Requests are matched by HTTP verb and URL. Repeated requests are answered in the order they were recorded.
+ *
+ *  Requests which the app makes itself, outside the remote data interface, are signed here with signServiceRequest(). The access token is taken from the service's token grant replies, and is never handed out.
+ *  A recorded traffic file is readable by its owner only, and the tokens in recorded token grants are replaced by a placeholder, which replay accepts like any other token.
+ *
+ *  File content transfers are tracked, so that they can be cancelled all at once by abortBulkTransfers().
+ *
+ *  In any mode, identical GET requests which are in flight at the same time are coalesced into one network call, whose reply is copied to every caller.
+ *  getRequestCount() and getBytesReceived() count what actually went over the network, or came from the traffic file. A coalesced read counts once, and body bytes are counted as they arrive.
+ *
+ *  prewarmConnections() opens encrypted connections to the service before they are needed, and keeps them open while idle.
+ *  TLS session tickets are saved to a file, so that the first connection of the next run can resume its session. The time to each TLS handshake is logged.
+ *
+ *  With enableResponseCache(), GET replies are kept in an HttpResponseCache and revalidated before reuse. Details of jobs which have ended are served from the cache with no request at all.
+ */
+
+class TrafficNetManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    explicit TrafficNetManager(TrafficMode mode, QString trafficFileName, double speed = 1.0, QObject *parent = nullptr);
+    ~TrafficNetManager();
+
+    TrafficMode getMode();
+
+    void storeRecord(TrafficRecord newRecord);
+    qint64 getSessionTime();
+
+    static QString getRequestKey(Operation op, const QNetworkRequest &req);
+
+    void setReadCoalescing(bool enabled);
+    void releaseCoalescedRead(QString coalesceKey, CoalescedRequest * finishedRead);
+    int getReadRequestCount();
+    int getCoalescedReadCount();
+
+    int getRequestCount();
+    qint64 getBytesReceived();
+
+    void setServiceBase(QString serviceBase);
+    bool signServiceRequest(QNetworkRequest &theRequest, QString servicePath);
+    static bool isTokenGrant(Operation op, const QUrl &theUrl);
+    void takeTokenGrant(const TrafficRecord &grantRecord);
+    static TrafficRecord redactTokenGrant(TrafficRecord grantRecord);
+
+    void enableResponseCache(QString cacheFolder, qint64 maxBytes);
+    int getCacheableReadCount();
+    int getCacheHitCount();
+    int getCacheOnlyCount();
+
+    int getHandshakeCount();
+    int getResumeOfferCount();
+    qint64 getHandshakeTotalTime();
+
+public slots:
+    void abortBulkTransfers();
+    void prewarmConnections(QString serviceBase, int connectionCount, QString ticketFile);
+
+private slots:
+    void sourceReplyFinished();
+    void countReceivedBytes(qint64 replyBytes, qint64);
+    void connectionEncrypted();
+    void keepConnectionsWarm();
+
+protected:
+    virtual QNetworkReply * createRequest(Operation op, const QNetworkRequest &req, QIODevice *outgoingData = nullptr);
+
+private:
+    bool loadTrafficFile();
+    QNetworkReply * createCoalescedReply(Operation op, const QNetworkRequest &req, QIODevice *outgoingData);
+    QNetworkReply * createSourceReply(Operation op, const QNetworkRequest &req, QIODevice *outgoingData);
+    QNetworkReply * createNetworkReply(Operation op, const QNetworkRequest &req, QIODevice *outgoingData);
+    void trackSourceReply(QNetworkReply * sourceReply);
+
+    void loadSessionTicket();
+    void saveSessionTicket(const QSslConfiguration &sslConfig);
+
+    TrafficMode myMode;
+    QFile trafficFile;
+    double replaySpeed = 1.0;
+
+    QElapsedTimer sessionTimer;
+    QHash<QString, QQueue<TrafficRecord>> replayRecords;
+
+    bool coalesceReads = true;
+    QHash<QString, CoalescedRequest *> inFlightReads;
+    QAtomicInt readRequestCount;
+    QAtomicInt coalescedReadCount;
+    QAtomicInt requestCount;
+    QAtomicInteger<qint64> bytesReceived;
+
+    QList<QPointer<QNetworkReply>> bulkTransfers;
+
+    QMutex authLock;
+    QString myServiceBase;
+    QByteArray accessToken;
+
+    QUrl warmServiceUrl;
+    int warmConnectionCount = 0;
+    bool prewarmUnderway = false;
+    QTimer keepWarmTimer;
+    QString ticketFileName;
+    QByteArray savedTicket;
+
+    HttpResponseCache * responseCache = nullptr;
+    QAtomicInt cacheableReadCount;
+    QAtomicInt cacheHitCount;
+    QAtomicInt cacheOnlyCount;
+
+    QAtomicInt handshakeCount;
+    QAtomicInt resumeOfferCount;
+    QAtomicInteger<qint64> handshakeTotalTime;
+};
+
+/*! \brief The TrafficRecordReply wraps a real network reply, passing data through to the reader while keeping a copy for the traffic file.
+ */
+
+class TrafficRecordReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    explicit TrafficRecordReply(QNetworkReply * realReply, QString requestKey, TrafficNetManager * manager);
+    ~TrafficRecordReply();
+
+    virtual void abort();
+    virtual void ignoreSslErrors();
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const;
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxSize);
+
+private slots:
+    void realMetaDataChanged();
+    void realDataReady();
+    void realError(QNetworkReply::NetworkError errorCode);
+    void realFinished();
+
+private:
+    QNetworkReply * myRealReply;
+    TrafficNetManager * myManager;
+
+    TrafficRecord myRecord;
+    QByteArray pendingData;
+    QElapsedTimer replyTimer;
+};
+
+/*! \brief The TrafficReplayReply serves a single recorded reply, after a given delay, as if it came from the network.
+ */
+
+class TrafficReplayReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    explicit TrafficReplayReply(Operation op, const QNetworkRequest &req, TrafficRecord theRecord, int delay, QObject *parent = nullptr);
+
+    virtual void abort();
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const;
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxSize);
+
+private slots:
+    void deliverReply();
+
+private:
+    TrafficRecord myRecord;
+    QByteArray pendingData;
+    bool delivered = false;
+};
+
+#endif // TRAFFICNETMANAGER_H
@@ -0,0 +1,222 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "transferjournal.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMessageBox>
+
+#include "remotedatainterface.h"
+#include "remoteFiles/fileoperator.h"
+#include "remoteFiles/filerecursiveoperator.h"
+
+#include "ae_globals.h"
+
+TransferJournal::TransferJournal(QString journalFileName, FileOperator * fileHandle, QObject *parent) : QObject(parent)
+{
+    myJournalFileName = journalFileName;
+    myFileHandle = fileHandle;
+
+    QObject::connect(myFileHandle, SIGNAL(fileOpDone(RequestState,QString)), this, SLOT(fileOperationDone(RequestState)));
+}
+
+bool TransferJournal::noteTransferStarted(TransferType type, QString remotePath, QString localPath)
+{
+    //A request refused by the file operator leaves it idle, and must not be resumed later
+    if (!myFileHandle->operationIsPending()) return false;
+
+    QJsonObject newEntry;
+    newEntry.insert("type", typeToString(type));
+    newEntry.insert("remotePath", remotePath);
+    newEntry.insert("localPath", localPath);
+    newEntry.insert("started", QDateTime::currentDateTime().toString(Qt::ISODate));
+
+    activeTransfers.append(newEntry);
+    return true;
+}
+
+int TransferJournal::unfinishedTransferCount()
+{
+    return activeTransfers.size() + resumeQueue.size();
+}
+
+bool TransferJournal::writeCheckpoint()
+{
+    QJsonArray journalEntries;
+    for (const QJsonObject &anEntry : activeTransfers)
+    {
+        journalEntries.append(anEntry);
+    }
+    for (const QJsonObject &anEntry : resumeQueue)
+    {
+        journalEntries.append(anEntry);
+    }
+
+    if (journalEntries.isEmpty())
+    {
+        QFile::remove(myJournalFileName);
+        return false;
+    }
+
+    QFile journalFile(myJournalFileName);
+    if (!journalFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCDebug(agaveAppLayer, "Unable to write transfer journal: %s", qPrintable(myJournalFileName));
+        return false;
+    }
+    journalFile.write(QJsonDocument(journalEntries).toJson(QJsonDocument::Compact));
+    journalFile.close();
+
+    qCDebug(agaveAppLayer, "Checkpointed %d unfinished transfers.", journalEntries.size());
+    return true;
+}
+
+void TransferJournal::offerResume()
+{
+    QFile journalFile(myJournalFileName);
+    if (!journalFile.open(QIODevice::ReadOnly)) return;
+
+    QJsonArray journalEntries = QJsonDocument::fromJson(journalFile.readAll()).array();
+    journalFile.close();
+    QFile::remove(myJournalFileName);
+
+    if (journalEntries.isEmpty()) return;
+
+    QMessageBox resumeQuery;
+    resumeQuery.setWindowTitle("Unfinished Transfers");
+    resumeQuery.setText(QString("%1 file transfer(s) did not finish in your last session. Start them again?").arg(journalEntries.size()));
+    resumeQuery.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+    resumeQuery.setDefaultButton(QMessageBox::Yes);
+    resumeQuery.setIcon(QMessageBox::Question);
+    if (resumeQuery.exec() != QMessageBox::Yes) return;
+
+    for (QJsonValue anEntry : journalEntries)
+    {
+        resumeQueue.append(anEntry.toObject());
+    }
+    startNextResume();
+}
+
+void TransferJournal::fileOperationDone(RequestState opState)
+{
+    //The file operator does one operation at a time, and refuses others while a noted transfer runs, so this is that transfer
+    if (!activeTransfers.isEmpty())
+    {
+        if (opState != RequestState::GOOD)
+        {
+            qCDebug(agaveAppLayer, "Transfer did not complete: %s", qPrintable(activeTransfers.first().value("remotePath").toString()));
+        }
+        activeTransfers.clear();
+    }
+
+    //Resumes wait for whatever other operation was running
+    startNextResume();
+}
+
+void TransferJournal::holdResumes()
+{
+    resumesHeld = true;
+}
+
+void TransferJournal::startNextResume()
+{
+    if (resumesHeld || !activeTransfers.isEmpty() || myFileHandle->operationIsPending()) return;
+
+    while (!resumeQueue.isEmpty())
+    {
+        QJsonObject nextEntry = resumeQueue.takeFirst();
+        if (startTransfer(nextEntry) && myFileHandle->operationIsPending())
+        {
+            activeTransfers.append(nextEntry);
+            return;
+        }
+    }
+}
+
+bool TransferJournal::startTransfer(QJsonObject transferEntry)
+{
+    QString type = transferEntry.value("type").toString();
+    QString remotePath = transferEntry.value("remotePath").toString();
+    QString localPath = transferEntry.value("localPath").toString();
+
+    bool remoteIsFolder = ((type == typeToString(TransferType::UPLOAD_FILE)) ||
+                           (type == typeToString(TransferType::UPLOAD_FOLDER)) ||
+                           (type == typeToString(TransferType::DOWNLOAD_FOLDER)));
+
+    FileNodeRef remoteNode = myFileHandle->speculateFileWithName(remotePath, remoteIsFolder);
+    if (remoteNode.isNil())
+    {
+        qCDebug(agaveAppLayer, "Unable to resume transfer, remote file not found: %s", qPrintable(remotePath));
+        return false;
+    }
+
+    qCDebug(agaveAppLayer, "Resuming transfer: %s %s", qPrintable(type), qPrintable(remotePath));
+    if (type == typeToString(TransferType::UPLOAD_FILE))
+    {
+        myFileHandle->sendUploadReq(remoteNode, localPath);
+    }
+    else if (type == typeToString(TransferType::UPLOAD_FOLDER))
+    {
+        myFileHandle->getRecursiveOp()->enactRecursiveUpload(remoteNode, localPath);
+    }
+    else if (type == typeToString(TransferType::DOWNLOAD_FILE))
+    {
+        myFileHandle->sendDownloadReq(remoteNode, localPath);
+    }
+    else if (type == typeToString(TransferType::DOWNLOAD_FOLDER))
+    {
+        myFileHandle->getRecursiveOp()->enactRecursiveDownload(remoteNode, localPath);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+QString TransferJournal::typeToString(TransferType type)
+{
+    switch (type)
+    {
+    case TransferType::UPLOAD_FILE: return "uploadFile";
+    case TransferType::UPLOAD_FOLDER: return "uploadFolder";
+    case TransferType::DOWNLOAD_FILE: return "downloadFile";
+    case TransferType::DOWNLOAD_FOLDER: return "downloadFolder";
+    }
+    return "unknown";
+}
@@ -0,0 +1,85 @@
+/*********************************************************************************
+**
+** Copyright (c) 2018 The University of Notre Dame
+** Copyright (c) 2018 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef TRANSFERJOURNAL_H
+#define TRANSFERJOURNAL_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+
+enum class TransferType {UPLOAD_FILE, UPLOAD_FOLDER, DOWNLOAD_FILE, DOWNLOAD_FOLDER};
+enum class RequestState;
+
+class FileOperator;
+
+/*! \brief The TransferJournal keeps track of file transfers started by the user, so that unfinished transfers can be resumed in the next session.
+ *
+ *  A transfer should only be noted once the FileOperator has accepted it, which noteTransferStarted() checks. It is considered finished when the FileOperator reports that its operation is done.
+ *  On shutdown, writeCheckpoint() saves any unfinished transfers to the journal file, without changing the journal's state. On the next start, offerResume() asks the user if they should be started again. They are then started one at a time, until holdResumes() is called.
+ */
+
+class TransferJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransferJournal(QString journalFileName, FileOperator * fileHandle, QObject *parent = nullptr);
+
+    bool noteTransferStarted(TransferType type, QString remotePath, QString localPath);
+    int unfinishedTransferCount();
+
+    bool writeCheckpoint();
+    void offerResume();
+    void holdResumes();
+
+private slots:
+    void fileOperationDone(RequestState opState);
+
+private:
+    void startNextResume();
+    bool startTransfer(QJsonObject transferEntry);
+
+    static QString typeToString(TransferType type);
+
+    QString myJournalFileName;
+    FileOperator * myFileHandle;
+
+    QList<QJsonObject> activeTransfers;
+    QList<QJsonObject> resumeQueue;
+    bool resumesHeld = false;
+};
+
+#endif // TRANSFERJOURNAL_H